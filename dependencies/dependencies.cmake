@@ -16,8 +16,19 @@ CPMAddPackage(
     OPTIONS "SPDLOG_FMT_EXTERNAL ON"
 )
 
+if(ARTI_BUILD_BENCH)
+    CPMAddPackage(
+        GITHUB_REPOSITORY "google/benchmark"
+        VERSION "1.8.3"
+        OPTIONS "BENCHMARK_ENABLE_TESTING OFF" "BENCHMARK_ENABLE_INSTALL OFF"
+    )
+endif()
+
 find_package(CURL REQUIRED)
 
+# Optional, lets arti::curl tell resumed TLS handshakes from full ones
+find_package(OpenSSL)
+
 set(CMAKE_PREFIX_PATH "${CMAKE_CURRENT_SOURCE_DIR}/dependencies/chafa" ${CMAKE_PREFIX_PATH})
 include(FindPkgConfig REQUIRED)
 pkg_check_modules(chafa REQUIRED IMPORTED_TARGET chafa)
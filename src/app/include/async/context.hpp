@@ -1,47 +1,166 @@
 #pragma once
 
 #include <mutex>
+#include <queue>
+#include <chrono>
 #include <thread>
+#include <vector>
 #include <variant>
+#include <utility>
 #include <optional>
 #include <functional>
-#include <unordered_map>
+#include <condition_variable>
 
 #include <fmt/format.h>
 #include <spdlog/spdlog.h>
 
+#include <cppcoro/task.hpp>
+
 #include <error.hpp>
 
-#include <async/schedule_policy.hpp>
+#include <async/future.hpp>
+#include <async/slot_map.hpp>
+#include <async/manual_clock.hpp>
 #include <async/thread_pool.hpp>
+#include <async/detached_task.hpp>
+#include <async/schedule_policy.hpp>
 
 namespace arti::async {
 
     struct context {
-        using scheduled_task_id = uint16_t;
+        // Stays unique for the life of the context, a handle to a finished
+        // task never refers to one scheduled later
+        using scheduled_task_id = slot_handle;
         using schedule_policy_t = std::variant<
             schedule_policy::infinity,
             schedule_policy::every,
             schedule_policy::once_after,
-            schedule_policy::n_times_every
+            schedule_policy::n_times_every,
+            schedule_policy::exponential_backoff,
+            schedule_policy::jittered_every
         >;
 
+        struct scheduled_task_stats {
+            scheduled_task_id id;
+            uint64_t runs;
+
+            // Runs that took longer than the policy period, from dispatch to
+            // completion, so time spent queued in a saturated pool counts too
+            uint64_t overruns;
+
+            // Fixed rate ticks dropped because the previous run overlapped them
+            uint64_t skipped;
+
+            std::chrono::nanoseconds last_run;
+            std::chrono::nanoseconds longest_run;
+
+            // How far past its deadline the callback actually started, timer
+            // slack, the update loop and pool queueing all add to it
+            std::chrono::nanoseconds last_lateness;
+            latency_histogram lateness;
+
+            // The callback alone, without the time it spent queued
+            latency_histogram callback_time;
+        };
+
+        // Returned by schedule(), usable from any thread. Every call returns
+        // false once the task is gone, whether it was cancelled or finished
+        struct scheduled_task_handle {
+            scheduled_task_handle() noexcept
+                : ctx(nullptr)
+                , task_id{} { }
+
+            scheduled_task_id id() const noexcept {
+                return task_id;
+            }
+
+            // A run already in flight finishes, nothing runs after it
+            bool cancel() {
+                return ctx != nullptr and ctx->cancel_task(task_id);
+            }
+
+            // Stops new runs until resume(), the policy state is kept
+            bool pause() {
+                return ctx != nullptr and ctx->pause_task(task_id, true);
+            }
+
+            // Runs right away if the task became due while paused
+            bool resume() {
+                return ctx != nullptr and ctx->pause_task(task_id, false);
+            }
+
+            // Next deadline is counted from the last run with the new period, a
+            // backoff that is failing keeps its current delay until its next run.
+            // Applied once the run finishes if the task is running. False for
+            // policies without a period
+            bool set_period(std::chrono::milliseconds period) {
+                return ctx != nullptr and ctx->set_task_period(task_id, period);
+            }
+
+          private:
+            friend struct context;
+
+            scheduled_task_handle(context *ctx, scheduled_task_id id) noexcept
+                : ctx(ctx)
+                , task_id(id) { }
+
+            context *ctx;
+            scheduled_task_id task_id;
+        };
+
+        struct stats_snapshot {
+            thread_pool::pool_stats io;
+            thread_pool::pool_stats compute;
+            std::vector<scheduled_task_stats> scheduled;
+
+            // How late scheduled runs were handed to the pool past their deadline,
+            // slack included
+            latency_histogram timer_jitter;
+
+            // Update loop passes that dispatched at least one timer
+            uint64_t timer_wakeups;
+        };
+
         context()
             : context(std::thread::hardware_concurrency()) { }
 
-        context(uint8_t num_threads)
-            : last_id(0)
-            , pool(
+        // num_threads and pool_options are for the I/O pool, the compute pool
+        // gets compute_threads workers and never grows
+        context(
+            std::size_t num_threads,
+            thread_pool_options pool_options = {},
+            std::size_t compute_threads = std::thread::hardware_concurrency()
+        )
+            : io_pool(
                 num_threads <= 2
                 ? 1
-                : (num_threads - 1)
+                : (num_threads - 1),
+                pool_options
             )
-            , stop_flag(false) {
-            spdlog::info(fmt::format("Started async context with {} threads", num_threads));
+            , compute_pool(compute_threads)
+            , manual(nullptr)
+            , started(false)
+            , stop_flag(false)
+            , running_count(0)
+            , timer_wakeups(0)
+            , wakeup_pending(false) {
+            spdlog::info(fmt::format("Started async context with {} I/O and {} compute threads", num_threads, compute_threads));
+        }
+
+        // Timers follow clock instead of real time and only fire from advance(),
+        // there's no update thread. Pool work still runs on real threads
+        explicit context(
+            manual_clock &clock,
+            std::size_t num_threads = 2,
+            thread_pool_options pool_options = {},
+            std::size_t compute_threads = 1
+        )
+            : context(num_threads, pool_options, compute_threads) {
+            manual = &clock;
         }
 
         ~context() {
-            if (update_thread.joinable()) {
+            if (started) {
                 join();
             }
         }
@@ -53,157 +172,731 @@ namespace arti::async {
         context &operator=(const context &) = delete;
 
         void initialize() {
-            pool.initialize();
-            update_thread = std::thread(std::bind_front(&context::update_loop, this));
+            io_pool.initialize();
+            compute_pool.initialize();
+
+            if (manual == nullptr) {
+                update_thread = std::thread(std::bind_front(&context::update_loop, this));
+            }
+
+            started = true;
         }
 
         void join() {
-            stop_flag = true;
-            update_thread.join();
-            pool.join();
+            {
+                std::scoped_lock lock(wakeup_mtx);
+                stop_flag = true;
+            }
+
+            wakeup_cv.notify_all();
+
+            if (update_thread.joinable()) {
+                update_thread.join();
+            }
+
+            io_pool.join();
+            compute_pool.join();
+
+            started = false;
+        }
+
+        // What the timers consider now, the manual clock if there's one
+        schedule_policy::impl::timer_clock::time_point now() const noexcept {
+            return manual != nullptr
+                ? manual->now()
+                : schedule_policy::impl::timer_clock::now();
         }
 
+        // Manual clock only. Moves it forward by step one deadline at a time,
+        // each run is waited for before time moves on so what fires depends
+        // only on the timers and never on how fast the pool is. Time moves at
+        // least 1ms per step, an infinity task runs once per virtual ms.
+        // Returns how many runs were dispatched
+        template <typename Rep, typename Period>
+        std::size_t advance(std::chrono::duration<Rep, Period> step) {
+            auto target = manual->now() + std::chrono::duration_cast<manual_clock::duration>(step);
+            std::size_t dispatched = 0;
+
+            while (true) {
+                dispatched += run_due_timers_and_wait();
+
+                auto next = [&] {
+                    std::scoped_lock lock(tasks_mtx);
+
+                    return timers.empty()
+                        ? std::nullopt
+                        : std::optional{ timers.top().latest };
+                }();
+
+                if (not next or *next > target) {
+                    break;
+                }
+
+                manual->set(std::max(*next, manual->now() + std::chrono::milliseconds{ 1 }));
+            }
+
+            manual->set(target);
+
+            return dispatched + run_due_timers_and_wait();
+        }
+
+        // callback returns a run_result, a bool (false stops the task) or nothing
         template <typename T, typename F>
         requires(
             std::is_same_v<T, schedule_policy::infinity>
             || std::is_same_v<T, schedule_policy::every>
             || std::is_same_v<T, schedule_policy::once_after>
             || std::is_same_v<T, schedule_policy::n_times_every>
+            || std::is_same_v<T, schedule_policy::exponential_backoff>
+            || std::is_same_v<T, schedule_policy::jittered_every>
         )
-        void schedule(T &&policy, F &&callback) {
-            last_id++;
+        scheduled_task_handle schedule(T &&policy, F &&callback) {
+            using schedule_policy::run_result;
 
             std::scoped_lock lock(tasks_mtx);
 
-            if constexpr (std::is_same_v<bool, std::invoke_result_t<F>>) {
-                tasks[last_id] = {
-                    .id = last_id,
-                    .type = std::forward<T>(policy),
-                    .callback = std::forward<F>(callback),
-                    .on_going_task = std::nullopt
-                };
-            }
-            else {
-                tasks[last_id] = {
-                    .id = last_id,
-                    .type = std::forward<T>(policy),
-                    .callback = [cback = std::forward<F>(callback)] {
+            auto [id, task] = [&] {
+                if constexpr (std::is_same_v<run_result, std::invoke_result_t<F>>) {
+                    return tasks.emplace(std::forward<T>(policy), std::forward<F>(callback));
+                }
+                else if constexpr (std::is_same_v<bool, std::invoke_result_t<F>>) {
+                    return tasks.emplace(std::forward<T>(policy), [cback = std::forward<F>(callback)] {
+                        return cback() ? run_result::success : run_result::stop;
+                    });
+                }
+                else {
+                    return tasks.emplace(std::forward<T>(policy), [cback = std::forward<F>(callback)] {
                         (void) cback();
-                        return true;
-                    },
-                    .on_going_task = std::nullopt
-                };
-            }
+                        return run_result::success;
+                    });
+                }
+            }();
+
+            task->id = id;
+            task->worker_hint = io_pool.current_worker();
+            task->stats.id = id;
+
+            std::visit(schedule_policy::impl::init_visitor{ now() }, task->type);
+            arm_timer(id, *task);
 
-            auto &ref = tasks.at(last_id);
+            wake_update_loop();
 
-            std::visit(schedule_policy::impl::init_visitor{}, ref.type);
+            return { this, id };
         }
 
         template <typename TaskCallback, typename... Args>
         auto run_async(TaskCallback &&callback, Args &&...args)
-            -> std::future<std::invoke_result_t<TaskCallback, Args...>> {
-            return pool.run_async(
+            -> expected<future<std::invoke_result_t<std::decay_t<TaskCallback>, std::decay_t<Args>...>>> {
+            return io_pool.run_async(
                 std::forward<TaskCallback>(callback),
                 std::forward<Args>(args)...
             );
         }
 
         template <typename TaskCallback, typename... Args>
-        void run_and_ignore(TaskCallback &&callback, Args &&...args) {
-            return pool.run_and_ignore(
+        auto run_async(priority prio, TaskCallback &&callback, Args &&...args)
+            -> expected<future<std::invoke_result_t<std::decay_t<TaskCallback>, std::decay_t<Args>...>>> {
+            return io_pool.run_async(
+                prio,
                 std::forward<TaskCallback>(callback),
                 std::forward<Args>(args)...
             );
         }
 
+        template <typename TaskCallback, typename... Args>
+        expected<> run_and_ignore(TaskCallback &&callback, Args &&...args) {
+            return io_pool.run_and_ignore(
+                std::forward<TaskCallback>(callback),
+                std::forward<Args>(args)...
+            );
+        }
+
+        template <typename TaskCallback, typename... Args>
+        expected<> run_and_ignore(priority prio, TaskCallback &&callback, Args &&...args) {
+            return io_pool.run_and_ignore(
+                prio,
+                std::forward<TaskCallback>(callback),
+                std::forward<Args>(args)...
+            );
+        }
+
+        template <typename TaskCallback, typename... Args>
+        expected<> run_and_ignore(coalesce_key key, priority prio, TaskCallback &&callback, Args &&...args) {
+            return io_pool.run_and_ignore(
+                std::move(key),
+                prio,
+                std::forward<TaskCallback>(callback),
+                std::forward<Args>(args)...
+            );
+        }
+
+        // Blocking network and file calls go here, it grows while they pile up.
+        // run_async, run_and_ignore, schedule and spawn all use it
+        thread_pool &io() noexcept {
+            return io_pool;
+        }
+
+        // Decoding and rendering, one worker per core so it never oversubscribes,
+        // nothing that blocks on I/O should run here
+        thread_pool &compute() noexcept {
+            return compute_pool;
+        }
+
+        // co_await ctx.schedule() continues the coroutine on an I/O worker
+        thread_pool::schedule_operation schedule(priority prio = priority::normal) noexcept {
+            return io_pool.schedule(prio);
+        }
+
+        // Hop between executors from inside a coroutine, e.g. after a download
+        // co_await ctx.on_compute() before decoding what came back
+        thread_pool::schedule_operation on_io(priority prio = priority::normal) noexcept {
+            return io_pool.schedule(prio);
+        }
+
+        thread_pool::schedule_operation on_compute(priority prio = priority::normal) noexcept {
+            return compute_pool.schedule(prio);
+        }
+
+        struct sleep_operation {
+            context *ctx;
+            std::chrono::milliseconds delay;
+
+            bool await_ready() const noexcept {
+                return delay <= std::chrono::milliseconds::zero();
+            }
+
+            // The scheduler only hands the resumption to the pool, the coroutine
+            // doesn't run inside the scheduled task
+            void await_suspend(std::coroutine_handle<> handle) const {
+                ctx->schedule(schedule_policy::once_after(delay), [pool = &ctx->io_pool, handle] {
+                    pool->post([handle] {
+                        handle.resume();
+                    });
+                });
+            }
+
+            void await_resume() const noexcept { }
+        };
+
+        // Suspends without holding a thread, resumes on the pool after delay
+        template <typename Rep, typename Period>
+        sleep_operation sleep_for(std::chrono::duration<Rep, Period> delay) noexcept {
+            return { this, std::chrono::ceil<std::chrono::milliseconds>(delay) };
+        }
+
+        // Starts task without waiting for it, exceptions are logged. It runs on
+        // the calling thread until its first suspension
+        void spawn(cppcoro::task<> task) {
+            run_detached(std::nullopt, std::move(task));
+        }
+
+        // Same, but the task starts on the pool in the given lane
+        void spawn(priority prio, cppcoro::task<> task) {
+            run_detached(io_pool.schedule(prio), std::move(task));
+        }
+
+        thread_pool::queue_stats queue_statistics() const {
+            return io_pool.queue_statistics();
+        }
+
+        stats_snapshot snapshot() const {
+            stats_snapshot result{
+                .io = io_pool.statistics(),
+                .compute = compute_pool.statistics(),
+                .scheduled = {},
+                .timer_jitter = {},
+                .timer_wakeups = timer_wakeups.load(std::memory_order_relaxed)
+            };
+
+            std::scoped_lock lock(tasks_mtx);
+
+            result.scheduled.reserve(tasks.size());
+
+            tasks.for_each([&](scheduled_task_id, const scheduled_task &task) {
+                result.scheduled.push_back(task.stats);
+            });
+
+            timer_jitter.collect(result.timer_jitter);
+
+            return result;
+        }
+
       private:
-        void update_loop() {
-            while (not stop_flag) {
-                std::list<scheduled_task_id> to_remove;
+        struct scheduled_task;
 
+        static impl::detached_task run_detached(std::optional<thread_pool::schedule_operation> start, cppcoro::task<> task) {
+            if (start) {
+                co_await *start;
+            }
+
+            try {
+                co_await task;
+            }
+            catch (std::exception &exc) {
+                spdlog::error(fmt::format("Unhandled exception in spawned coroutine: '{}'", exc.what()));
+            }
+            catch (...) {
+                spdlog::error("Unhandled exception in spawned coroutine");
+            }
+        }
+
+        void wake_update_loop() {
+            {
+                std::scoped_lock lock(wakeup_mtx);
+                wakeup_pending = true;
+            }
+
+            wakeup_cv.notify_one();
+        }
+
+        std::size_t run_due_timers_and_wait() {
+            auto dispatched = [&] {
+                std::scoped_lock lock(tasks_mtx);
+
+                collect_finished_runs();
+                return dispatch_due_timers();
+            }();
+
+            while (true) {
                 {
                     std::scoped_lock lock(tasks_mtx);
+                    collect_finished_runs();
 
-                    for (auto &[id, task] : tasks) {
-                        if (not task.on_going_task.has_value()) {
-                            namespace sch_pcy = schedule_policy;
-                            using sch_act = sch_pcy::impl::scheduler_action;
-
-                            auto action = std::visit(
-                                sch_pcy::impl::update_visitor{},
-                                task.type
-                            );
-
-                            switch (action) {
-                                case sch_act::run:
-                                    task.on_going_task =
-                                        pool.run_async(
-                                                [](scheduled_task *tsk) {
-                                                    if (not tsk->callback()) {
-                                                        return sch_pcy::impl::scheduler_action::cancel;
-                                                    }
-
-                                                    return std::visit(
-                                                        sch_pcy::impl::after_visitor{},
-                                                        tsk->type
-                                                    );
-                                                },
-                                                &task
-                                            );
-                                    break;
-                                case sch_act::cancel:
-                                    to_remove.push_back(id);
-                                    break;
-                                default: break;
-                            }
-                        }
+                    if (running_count == 0) {
+                        return dispatched;
                     }
+                }
 
-                    for (auto &[id, task] : tasks) {
-                        if (task.on_going_task.has_value()) {
-                            auto future_status = task.on_going_task->wait_for(std::chrono::milliseconds(0));
-
-                            if (future_status == std::future_status::ready) {
-                                auto action = task.on_going_task->get();
-
-                                switch (action) {
-                                    case schedule_policy::impl::scheduler_action::cancel:
-                                        to_remove.push_back(id);
-                                        break;
-                                    default:
-                                        task.on_going_task = std::nullopt;
-                                        break;
-                                }
-                            }
-                        }
+                std::unique_lock lock(wakeup_mtx);
+                wakeup_cv.wait(lock, [&] { return wakeup_pending; });
+                wakeup_pending = false;
+            }
+        }
+
+        // Sleeps until the earliest timer runs out of slack, a schedule() call
+        // or a run finishing wakes it earlier
+        void update_loop() {
+            while (true) {
+                auto next_deadline = [&] {
+                    std::scoped_lock lock(tasks_mtx);
+
+                    collect_finished_runs();
+                    dispatch_due_timers();
+
+                    return timers.empty()
+                        ? std::nullopt
+                        : std::optional{ timers.top().latest };
+                }();
+
+                std::unique_lock lock(wakeup_mtx);
+
+                auto woken = [&] {
+                    return wakeup_pending or stop_flag;
+                };
+
+                if (next_deadline) {
+                    wakeup_cv.wait_until(lock, *next_deadline, woken);
+                }
+                else {
+                    wakeup_cv.wait(lock, woken);
+                }
+
+                if (stop_flag) {
+                    break;
+                }
+
+                wakeup_pending = false;
+            }
+        }
+
+        void collect_finished_runs() {
+            namespace sch_pcy = schedule_policy;
+            using sch_act = sch_pcy::impl::scheduler_action;
+
+            {
+                std::scoped_lock lock(completed_mtx);
+                finished.swap(completed);
+            }
+
+            for (const auto &outcome : finished) {
+                running_count--;
+
+                auto *found = tasks.find(outcome.id);
+
+                if (found == nullptr) {
+                    continue;
+                }
+
+                auto &task = *found;
+                auto elapsed = outcome.finished_at - task.dispatched_at;
+                auto &report = outcome.report;
+
+                auto period = std::visit([](const auto &policy) -> std::optional<std::chrono::nanoseconds> {
+                    if constexpr (requires { policy.period; }) {
+                        return policy.period;
                     }
+                    else {
+                        return std::nullopt;
+                    }
+                }, task.type);
+
+                task.stats.runs++;
+                task.stats.last_run = elapsed;
+                task.stats.longest_run = std::max(task.stats.longest_run, elapsed);
 
-                    for (auto id : to_remove) {
-                        tasks.erase(id);
+                if (period and elapsed > *period) {
+                    task.stats.overruns++;
+                }
+
+                // Runs the pool dropped never started
+                if (report.started) {
+                    task.stats.callback_time.record(report.ran_for);
+
+                    if (task.dispatched_for != sch_pcy::impl::timer_clock::time_point::min()) {
+                        task.stats.last_lateness = report.started_at - task.dispatched_for;
+                        task.stats.lateness.record(task.stats.last_lateness);
+                    }
+                }
+
+                task.stats.skipped = std::visit([](const auto &policy) -> uint64_t {
+                    if constexpr (requires { policy.skipped_ticks(); }) {
+                        return policy.skipped_ticks();
                     }
+                    else {
+                        return 0;
+                    }
+                }, task.type);
+
+                if (report.action == sch_act::cancel or task.cancelled) {
+                    tasks.erase(outcome.id);
+                    continue;
+                }
+
+                task.running = false;
+
+                if (task.pending_period) {
+                    set_period(task.type, *std::exchange(task.pending_period, std::nullopt));
+                }
+
+                if (not task.paused) {
+                    arm_timer(outcome.id, task);
+                }
+            }
+
+            finished.clear();
+        }
+
+        bool cancel_task(scheduled_task_id id) {
+            std::scoped_lock lock(tasks_mtx);
+
+            auto *task = tasks.find(id);
+
+            if (task == nullptr or task->cancelled) {
+                return false;
+            }
+
+            // Its pending timer entry goes stale, an in-flight run is
+            // erased when collected
+            if (task->running) {
+                task->cancelled = true;
+            }
+            else {
+                tasks.erase(id);
+            }
+
+            return true;
+        }
+
+        bool pause_task(scheduled_task_id id, bool paused) {
+            std::scoped_lock lock(tasks_mtx);
+
+            auto *task = tasks.find(id);
+
+            if (task == nullptr or task->cancelled) {
+                return false;
+            }
+
+            if (task->paused != paused) {
+                task->paused = paused;
+
+                if (not paused and not task->running) {
+                    arm_timer(id, *task);
+                    wake_update_loop();
+                }
+            }
+
+            return true;
+        }
+
+        bool set_task_period(scheduled_task_id id, std::chrono::milliseconds period) {
+            std::scoped_lock lock(tasks_mtx);
+
+            auto *task = tasks.find(id);
+
+            if (task == nullptr or task->cancelled) {
+                return false;
+            }
+
+            // A running task's policy belongs to the worker until it's collected
+            if (task->running) {
+                task->pending_period = period;
+                return has_period(task->type);
+            }
+
+            if (not set_period(task->type, period)) {
+                return false;
+            }
+
+            if (not task->paused) {
+                arm_timer(id, *task);
+                wake_update_loop();
+            }
+
+            return true;
+        }
+
+        static bool has_period(const schedule_policy_t &type) {
+            return std::visit([](const auto &policy) {
+                return requires { policy.period; };
+            }, type);
+        }
+
+        static bool set_period(schedule_policy_t &type, std::chrono::milliseconds period) {
+            return std::visit([period](auto &policy) {
+                // Policies waiting on a delay of their own update it too
+                if constexpr (requires { policy.set_period(period); }) {
+                    policy.set_period(period);
+                    return true;
+                }
+                else if constexpr (requires { policy.period; }) {
+                    policy.period = period;
+                    return true;
+                }
+                else {
+                    return false;
+                }
+            }, type);
+        }
+
+        // Supersedes whatever entry the task already had in timers
+        void arm_timer(scheduled_task_id id, scheduled_task &task) {
+            auto &type = task.type;
+            auto deadline = std::visit(schedule_policy::impl::deadline_visitor{}, type);
+
+            auto slack = std::visit([](const auto &policy) {
+                if constexpr (requires { policy.slack; }) {
+                    return policy.slack;
+                }
+                else {
+                    return std::chrono::milliseconds::zero();
+                }
+            }, type);
+
+            timers.push({ .deadline = deadline, .latest = deadline + slack, .id = id, .sequence = ++task.timer_sequence });
+        }
+
+        // Every idle task has exactly one live entry in timers, a running or
+        // paused one has none. Whoever wakes the loop also takes every
+        // timer already inside its slack window, so timers whose windows overlap
+        // share one wakeup instead of firing a few ms apart
+        std::size_t dispatch_due_timers() {
+            namespace sch_pcy = schedule_policy;
+            using sch_act = sch_pcy::impl::scheduler_action;
+
+            auto now = this->now();
+            std::size_t dispatched = 0;
+
+            while (not timers.empty() and timers.top().deadline <= now) {
+                auto entry = timers.top();
+                timers.pop();
+
+                auto *found = tasks.find(entry.id);
+
+                if (found == nullptr or found->running or found->paused or entry.sequence != found->timer_sequence) {
+                    continue;
+                }
+
+                auto &task = *found;
+                auto action = std::visit(sch_pcy::impl::update_visitor{ now }, task.type);
+
+                if (action == sch_act::cancel) {
+                    tasks.erase(entry.id);
+                    continue;
+                }
+
+                if (action == sch_act::wait) {
+                    arm_timer(entry.id, task);
+                    continue;
+                }
+
+                if (entry.deadline != sch_pcy::impl::timer_clock::time_point::min()) {
+                    timer_jitter.record(now - entry.deadline);
+                }
+
+                auto submitted = io_pool.run_async_on(
+                    task.worker_hint,
+                    priority::normal,
+                    [this](scheduled_task *tsk) {
+                        // Timer time for the policy, real time for the duration
+                        auto started_at = this->now();
+                        auto real_start = std::chrono::steady_clock::now();
+                        auto result = tsk->callback();
+                        auto ran_for = std::chrono::steady_clock::now() - real_start;
+
+                        auto action = result == sch_pcy::run_result::stop
+                            ? sch_act::cancel
+                            : std::visit(sch_pcy::impl::after_visitor{ result, this->now() }, tsk->type);
+
+                        return run_report{ .action = action, .started = true, .started_at = started_at, .ran_for = ran_for };
+                    },
+                    &task
+                );
+
+                // Queue is full, the task stays due and is retried a bit later
+                if (not submitted) {
+                    spdlog::debug(fmt::format("Couldn't run scheduled task {}: '{}'", entry.id.value, submitted.error()));
+                    timers.push({ .deadline = now + retry_delay, .latest = now + retry_delay, .id = entry.id, .sequence = entry.sequence });
+                    continue;
                 }
+
+                task.running = true;
+                task.dispatched_at = now;
+                running_count++;
+                dispatched++;
+                task.dispatched_for = entry.deadline;
+
+                // Runs on the worker that finished the task, only hands the
+                // outcome back to this loop
+                submitted->when_ready(inline_executor(), [this, id = entry.id](future<run_report> done) {
+                    auto report = [&] {
+                        try {
+                            return done.get();
+                        }
+                        catch (std::future_error &) {
+                            // Dropped by the pool before it ran
+                            return run_report{ .action = sch_act::wait, .started = false, .started_at = {}, .ran_for = {} };
+                        }
+                    }();
+
+                    auto finished_at = this->now();
+
+                    {
+                        std::scoped_lock lock(completed_mtx);
+                        completed.push_back({ .id = id, .report = report, .finished_at = finished_at });
+                    }
+
+                    wake_update_loop();
+                });
             }
+
+            if (dispatched > 0) {
+                impl::atomic_histogram::bump(timer_wakeups, 1);
+            }
+
+            return dispatched;
         }
 
+        // Its address is handed to the pool for every run, the slot map never
+        // moves it and it's only erased while no run is in flight
         struct scheduled_task {
+            scheduled_task(schedule_policy_t policy, std::function<schedule_policy::run_result()> cback)
+                : id{}
+                , type(std::move(policy))
+                , callback(std::move(cback))
+                , running(false)
+                , paused(false)
+                , cancelled(false)
+                , timer_sequence(0)
+                , stats{} { }
+
             scheduled_task_id id;
             schedule_policy_t type;
 
-            std::function<bool()> callback;
+            std::function<schedule_policy::run_result()> callback;
+
+            // Worker that called schedule(), if any, runs go to its queue first
+            std::optional<std::size_t> worker_hint;
+
+            // Set while a run is queued or executing, cleared by its completion
+            bool running;
+            std::chrono::steady_clock::time_point dispatched_at;
+
+            // Deadline of the run in flight
+            schedule_policy::impl::timer_clock::time_point dispatched_for;
+
+            bool paused;
+            bool cancelled;
+
+            // Applied once the in-flight run is collected
+            std::optional<std::chrono::milliseconds> pending_period;
 
-            std::optional<std::future<schedule_policy::impl::scheduler_action>> on_going_task;
+            // Only the timer entry carrying the latest sequence is live
+            uint32_t timer_sequence;
+
+            scheduled_task_stats stats;
         };
 
-        scheduled_task_id last_id;
+        // Filled by the worker that ran the callback
+        struct run_report {
+            schedule_policy::impl::scheduler_action action;
+
+            // False when the pool dropped the run before it started
+            bool started;
+            schedule_policy::impl::timer_clock::time_point started_at;
+            std::chrono::nanoseconds ran_for;
+        };
 
-        thread_pool pool;
+        struct run_outcome {
+            scheduled_task_id id;
+            run_report report;
+            std::chrono::steady_clock::time_point finished_at;
+        };
+
+        // Due at deadline, must fire by latest. The heap is ordered by latest,
+        // that's when the loop has to wake up
+        struct timer_entry {
+            schedule_policy::impl::timer_clock::time_point deadline;
+            schedule_policy::impl::timer_clock::time_point latest;
+            scheduled_task_id id;
+            uint32_t sequence;
+
+            friend bool operator>(const timer_entry &lhs, const timer_entry &rhs) {
+                return lhs.latest > rhs.latest;
+            }
+        };
+
+        // How long a scheduled run waits before retrying when the pool refused it
+        static constexpr std::chrono::milliseconds retry_delay{ 10 };
+
+        thread_pool io_pool;
+        thread_pool compute_pool;
+
+        manual_clock *manual;
+        bool started;
 
         std::atomic_bool stop_flag;
         std::thread update_thread;
 
-        std::mutex tasks_mtx;
-        std::unordered_map<scheduled_task_id, scheduled_task> tasks;
+        mutable std::mutex tasks_mtx;
+        slot_map<scheduled_task> tasks;
+
+        // Runs dispatched and not collected yet
+        std::size_t running_count;
+        std::priority_queue<timer_entry, std::vector<timer_entry>, std::greater<>> timers;
+
+        // Only touched by the update thread
+        std::vector<run_outcome> finished;
+        impl::atomic_histogram timer_jitter;
+        std::atomic_uint64_t timer_wakeups;
+
+        std::mutex completed_mtx;
+        std::vector<run_outcome> completed;
+
+        // Separate from tasks_mtx, a run can complete inline while the update
+        // thread still holds that one
+        std::mutex wakeup_mtx;
+        std::condition_variable wakeup_cv;
+        bool wakeup_pending;
     };
 
 }    // namespace arti::async
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <coroutine>
+#include <exception>
+
+namespace arti::async::impl {
+
+    // Eagerly started coroutine nobody waits on, its frame frees itself once
+    // it finishes. Bodies must catch their own exceptions
+    struct detached_task {
+        struct promise_type {
+            detached_task get_return_object() noexcept {
+                return {};
+            }
+
+            std::suspend_never initial_suspend() noexcept {
+                return {};
+            }
+
+            std::suspend_never final_suspend() noexcept {
+                return {};
+            }
+
+            void return_void() noexcept { }
+
+            void unhandled_exception() noexcept {
+                std::terminate();
+            }
+        };
+    };
+
+}    // namespace arti::async::impl
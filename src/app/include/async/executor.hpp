@@ -0,0 +1,56 @@
+#pragma once
+
+#include <utility>
+#include <type_traits>
+
+#include <async/unique_function.hpp>
+
+namespace arti::async {
+
+    // Unit of work handed to an executor, continuations and resumptions
+    using job_t = unique_function<void(), 64>;
+
+    // Non owning, type erased reference to anything with a post(job_t &&)
+    // member. A default constructed one runs jobs inline on the calling thread
+    struct executor_ref {
+        executor_ref() noexcept
+            : self(nullptr)
+            , post_fn(nullptr) { }
+
+        template <typename Executor>
+        requires(not std::is_same_v<std::remove_cvref_t<Executor>, executor_ref>)
+        executor_ref(Executor &executor) noexcept
+            : self(&executor)
+            , post_fn([](void *exec, job_t &&job) {
+                static_cast<Executor *>(exec)->post(std::move(job));
+            }) { }
+
+        void post(job_t &&job) const {
+            if (post_fn) {
+                post_fn(self, std::move(job));
+            }
+            else {
+                // Own it first, the job may release whatever was holding it
+                auto owned = std::move(job);
+                owned();
+            }
+        }
+
+        bool is_inline() const noexcept {
+            return post_fn == nullptr;
+        }
+
+        friend bool operator==(const executor_ref &lhs, const executor_ref &rhs) noexcept {
+            return lhs.self == rhs.self;
+        }
+
+      private:
+        void *self;
+        void (*post_fn)(void *, job_t &&);
+    };
+
+    inline executor_ref inline_executor() noexcept {
+        return {};
+    }
+
+}    // namespace arti::async
@@ -0,0 +1,577 @@
+#pragma once
+
+#include <mutex>
+#include <tuple>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <variant>
+#include <coroutine>
+#include <cstdint>
+#include <utility>
+#include <optional>
+#include <stdexcept>
+#include <exception>
+#include <functional>
+#include <type_traits>
+
+#include <async/executor.hpp>
+
+namespace arti::async {
+
+    template <typename T>
+    struct future;
+
+    template <typename T>
+    struct promise;
+
+    namespace impl {
+
+        template <typename T>
+        using stored_t = std::conditional_t<std::is_void_v<T>, std::monostate, T>;
+
+        enum state_flag : uint32_t {
+            pending,
+            subscribed,
+            ready
+        };
+
+        // Single allocation shared by one promise and one future. Whoever comes
+        // second between the value and the continuation is the one firing it
+        template <typename T>
+        struct shared_state {
+            shared_state()
+                : flag(pending)
+                , references(1) { }
+
+            void acquire() {
+                references.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            void release() {
+                if (references.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                    delete this;
+                }
+            }
+
+            template <typename... V>
+            void set_value(V &&...value) {
+                result.template emplace<1>(std::forward<V>(value)...);
+                publish();
+            }
+
+            void set_exception(std::exception_ptr exception) {
+                result.template emplace<2>(std::move(exception));
+                publish();
+            }
+
+            void publish() {
+                auto previous = flag.exchange(ready, std::memory_order_acq_rel);
+                flag.notify_all();
+
+                if (previous == subscribed) {
+                    continuation_executor.post(std::move(continuation));
+                }
+            }
+
+            void subscribe(executor_ref exec, job_t &&job) {
+                continuation_executor = exec;
+                continuation = std::move(job);
+
+                auto expected_flag = static_cast<uint32_t>(pending);
+
+                if (not flag.compare_exchange_strong(expected_flag, subscribed, std::memory_order_acq_rel)) {
+                    // Already ready, nobody else is going to fire it
+                    continuation_executor.post(std::move(continuation));
+                }
+            }
+
+            bool is_ready() const {
+                return flag.load(std::memory_order_acquire) == ready;
+            }
+
+            void wait() const {
+                auto current = flag.load(std::memory_order_acquire);
+
+                while (current != ready) {
+                    flag.wait(current, std::memory_order_acquire);
+                    current = flag.load(std::memory_order_acquire);
+                }
+            }
+
+            std::atomic_uint32_t flag;
+            std::atomic_uint32_t references;
+            std::variant<std::monostate, stored_t<T>, std::exception_ptr> result;
+
+            // Where continuations run unless told otherwise, the pool that made it
+            executor_ref default_executor;
+
+            executor_ref continuation_executor;
+            job_t continuation;
+        };
+
+        template <typename T, typename F>
+        struct then_result {
+            using type = std::invoke_result_t<F, T>;
+        };
+
+        template <typename F>
+        struct then_result<void, F> {
+            using type = std::invoke_result_t<F>;
+        };
+
+        template <typename T>
+        struct is_future : std::false_type { };
+
+        template <typename T>
+        struct is_future<future<T>> : std::true_type { };
+
+    }    // namespace impl
+
+    // Lighter std::future, only one allocation for the shared state and no
+    // mutex or condition variable, waiting is done on the state flag itself.
+    // Continuations attached with then() or when_ready() never block a thread
+    template <typename T>
+    struct future {
+        using value_type = T;
+
+        future() noexcept
+            : state(nullptr) { }
+
+        ~future() {
+            if (state) {
+                state->release();
+            }
+        }
+
+        future(future &&other) noexcept
+            : state(std::exchange(other.state, nullptr)) { }
+
+        future &operator=(future &&other) noexcept {
+            if (this != &other) {
+                if (state) {
+                    state->release();
+                }
+
+                state = std::exchange(other.state, nullptr);
+            }
+
+            return *this;
+        }
+
+        future(const future &) = delete;
+        future &operator=(const future &) = delete;
+
+        bool valid() const noexcept {
+            return state != nullptr;
+        }
+
+        bool is_ready() const {
+            return state->is_ready();
+        }
+
+        void wait() const {
+            state->wait();
+        }
+
+        template <typename Rep, typename Period>
+        std::future_status wait_for(std::chrono::duration<Rep, Period> timeout) const {
+            return wait_until(std::chrono::steady_clock::now() + timeout);
+        }
+
+        // std::atomic has no timed wait, short timeouts are served by polling,
+        // the zero timeout case never sleeps
+        template <typename Clock, typename Duration>
+        std::future_status wait_until(std::chrono::time_point<Clock, Duration> deadline) const {
+            using namespace std::chrono_literals;
+
+            while (not state->is_ready()) {
+                auto now = Clock::now();
+
+                if (now >= deadline) {
+                    return std::future_status::timeout;
+                }
+
+                std::this_thread::sleep_for(std::min<std::chrono::nanoseconds>(deadline - now, 1ms));
+            }
+
+            return std::future_status::ready;
+        }
+
+        T get() {
+            wait();
+
+            auto *owned = std::exchange(state, nullptr);
+
+            struct releaser {
+                impl::shared_state<T> *s;
+
+                ~releaser() {
+                    s->release();
+                }
+            } guard{ owned };
+
+            if (owned->result.index() == 2) {
+                std::rethrow_exception(std::get<2>(owned->result));
+            }
+
+            if constexpr (not std::is_void_v<T>) {
+                return std::move(std::get<1>(owned->result));
+            }
+        }
+
+        executor_ref get_executor() const {
+            return state->default_executor;
+        }
+
+        // co_await on a future suspends until it is ready and resumes on the
+        // thread that completed it, then yields the value or rethrows
+        auto operator co_await() && noexcept {
+            struct awaiter {
+                future pending;
+
+                bool await_ready() const {
+                    return pending.is_ready();
+                }
+
+                void await_suspend(std::coroutine_handle<> handle) {
+                    pending.when_ready(inline_executor(), [this, handle](future ready) {
+                        pending = std::move(ready);
+                        handle.resume();
+                    });
+                }
+
+                T await_resume() {
+                    return pending.get();
+                }
+            };
+
+            return awaiter{ std::move(*this) };
+        }
+
+        // Consumes the future, callback receives it back once ready (so get()
+        // won't block) and runs on exec
+        template <typename F>
+        requires(std::is_invocable_v<F, future<T>>)
+        void when_ready(executor_ref exec, F &&callback) {
+            auto *owned = std::exchange(state, nullptr);
+
+            owned->subscribe(
+                exec,
+                [ready = future{ owned }, cback = std::forward<F>(callback)]() mutable {
+                    std::invoke(std::move(cback), std::move(ready));
+                }
+            );
+        }
+
+        template <typename F>
+        requires(std::is_invocable_v<F, future<T>>)
+        void when_ready(F &&callback) {
+            auto exec = state->default_executor;
+            when_ready(exec, std::forward<F>(callback));
+        }
+
+        // Chains callback on the value, the returned future holds its result. If
+        // this one failed callback is skipped and the exception carried over
+        template <typename F>
+        auto then(executor_ref exec, F &&callback) -> future<typename impl::then_result<T, F>::type> {
+            using return_t = typename impl::then_result<T, F>::type;
+
+            promise<return_t> next{ exec };
+            auto next_future = next.get_future();
+
+            when_ready(
+                exec,
+                [next = std::move(next), cback = std::forward<F>(callback)](future<T> ready) mutable {
+                    try {
+                        if constexpr (std::is_void_v<T> and std::is_void_v<return_t>) {
+                            ready.get();
+                            std::invoke(std::move(cback));
+                            next.set_value();
+                        }
+                        else if constexpr (std::is_void_v<T>) {
+                            ready.get();
+                            next.set_value(std::invoke(std::move(cback)));
+                        }
+                        else if constexpr (std::is_void_v<return_t>) {
+                            std::invoke(std::move(cback), ready.get());
+                            next.set_value();
+                        }
+                        else {
+                            next.set_value(std::invoke(std::move(cback), ready.get()));
+                        }
+                    }
+                    catch (...) {
+                        next.set_exception(std::current_exception());
+                    }
+                }
+            );
+
+            return next_future;
+        }
+
+        template <typename F>
+        auto then(F &&callback) -> future<typename impl::then_result<T, F>::type> {
+            auto exec = state->default_executor;
+            return then(exec, std::forward<F>(callback));
+        }
+
+      private:
+        friend struct promise<T>;
+
+        explicit future(impl::shared_state<T> *state)
+            : state(state) { }
+
+        impl::shared_state<T> *state;
+    };
+
+    template <typename T>
+    struct promise {
+        promise()
+            : promise(executor_ref{}) { }
+
+        // Continuations on the future run on exec unless they ask for another one
+        explicit promise(executor_ref exec)
+            : state(new impl::shared_state<T>())
+            , future_retrieved(false) {
+            state->default_executor = exec;
+        }
+
+        ~promise() {
+            if (state) {
+                if (not state->is_ready()) {
+                    state->set_exception(
+                        std::make_exception_ptr(std::future_error(std::future_errc::broken_promise))
+                    );
+                }
+
+                state->release();
+            }
+        }
+
+        promise(promise &&other) noexcept
+            : state(std::exchange(other.state, nullptr))
+            , future_retrieved(other.future_retrieved) { }
+
+        promise &operator=(promise &&other) noexcept {
+            if (this != &other) {
+                promise discarded{ std::move(*this) };
+
+                state = std::exchange(other.state, nullptr);
+                future_retrieved = other.future_retrieved;
+            }
+
+            return *this;
+        }
+
+        promise(const promise &) = delete;
+        promise &operator=(const promise &) = delete;
+
+        future<T> get_future() {
+            if (future_retrieved) {
+                throw std::future_error(std::future_errc::future_already_retrieved);
+            }
+
+            future_retrieved = true;
+            state->acquire();
+
+            return future<T>{ state };
+        }
+
+        template <typename... V>
+        void set_value(V &&...value) {
+            state->set_value(std::forward<V>(value)...);
+        }
+
+        void set_exception(std::exception_ptr exception) {
+            state->set_exception(std::move(exception));
+        }
+
+      private:
+        impl::shared_state<T> *state;
+        bool future_retrieved;
+    };
+
+    template <typename T, typename... V>
+    future<T> make_ready_future(V &&...value) {
+        promise<T> prms;
+        auto ready = prms.get_future();
+        prms.set_value(std::forward<V>(value)...);
+        return ready;
+    }
+
+    template <typename T>
+    struct when_any_result {
+        std::size_t index;
+        impl::stored_t<T> value;
+    };
+
+    namespace impl {
+
+        // Shared by the continuations of every input of a when_all/when_any.
+        // Storage is what the inputs write into, when it differs from Result
+        // it's converted once every input finished
+        template <typename Result, typename Storage = Result>
+        struct combinator_state {
+            explicit combinator_state(std::size_t remaining, executor_ref exec)
+                : remaining(remaining)
+                , done(false)
+                , output(exec) { }
+
+            std::atomic_size_t remaining;
+            std::atomic_bool done;
+
+            std::mutex error_mtx;
+            std::exception_ptr first_error;
+
+            Storage values;
+            promise<Result> output;
+        };
+
+    }    // namespace impl
+
+    // Ready once every input is, values keep the input order. If any input
+    // fails the first exception is forwarded after all of them finished
+    template <typename T>
+    future<std::vector<impl::stored_t<T>>> when_all(std::vector<future<T>> inputs) {
+        using result_t = std::vector<impl::stored_t<T>>;
+
+        // Each input writes its own slot from whichever thread completes it.
+        // Separate objects instead of vector<T> elements, which for bool share
+        // a word
+        using storage_t = std::vector<std::optional<impl::stored_t<T>>>;
+
+        if (inputs.empty()) {
+            return make_ready_future<result_t>();
+        }
+
+        auto shared = std::make_shared<impl::combinator_state<result_t, storage_t>>(inputs.size(), inputs.front().get_executor());
+        shared->values.resize(inputs.size());
+
+        auto output = shared->output.get_future();
+
+        for (std::size_t i = 0; i < inputs.size(); ++i) {
+            inputs[i].when_ready(inline_executor(), [shared, i](future<T> ready) {
+                try {
+                    if constexpr (std::is_void_v<T>) {
+                        ready.get();
+                    }
+                    else {
+                        shared->values[i].emplace(ready.get());
+                    }
+                }
+                catch (...) {
+                    std::scoped_lock lock(shared->error_mtx);
+
+                    if (not shared->first_error) {
+                        shared->first_error = std::current_exception();
+                    }
+                }
+
+                if (shared->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                    if (shared->first_error) {
+                        shared->output.set_exception(shared->first_error);
+                    }
+                    else {
+                        result_t values;
+                        values.reserve(shared->values.size());
+
+                        // void inputs never wrote their slot
+                        for (auto &value : shared->values) {
+                            values.push_back(value ? std::move(*value) : impl::stored_t<T>{});
+                        }
+
+                        shared->output.set_value(std::move(values));
+                    }
+                }
+            });
+        }
+
+        return output;
+    }
+
+    template <typename... T>
+    future<std::tuple<impl::stored_t<T>...>> when_all(future<T>... inputs) {
+        using result_t = std::tuple<impl::stored_t<T>...>;
+
+        auto exec = std::get<0>(std::forward_as_tuple(inputs...)).get_executor();
+        auto shared = std::make_shared<impl::combinator_state<result_t>>(sizeof...(T), exec);
+        auto output = shared->output.get_future();
+
+        auto attach = [&]<std::size_t I, typename V>(std::integral_constant<std::size_t, I>, future<V> &input) {
+            input.when_ready(inline_executor(), [shared](future<V> ready) {
+                try {
+                    if constexpr (std::is_void_v<V>) {
+                        ready.get();
+                    }
+                    else {
+                        std::get<I>(shared->values) = ready.get();
+                    }
+                }
+                catch (...) {
+                    std::scoped_lock lock(shared->error_mtx);
+
+                    if (not shared->first_error) {
+                        shared->first_error = std::current_exception();
+                    }
+                }
+
+                if (shared->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                    if (shared->first_error) {
+                        shared->output.set_exception(shared->first_error);
+                    }
+                    else {
+                        shared->output.set_value(std::move(shared->values));
+                    }
+                }
+            });
+        };
+
+        [&]<std::size_t... I>(std::index_sequence<I...>) {
+            (attach(std::integral_constant<std::size_t, I>{}, inputs), ...);
+        }(std::index_sequence_for<T...>{});
+
+        return output;
+    }
+
+    // Ready as soon as the first input is, carrying its index and value (or its
+    // exception). The rest still run, their results are discarded
+    template <typename T>
+    future<when_any_result<T>> when_any(std::vector<future<T>> inputs) {
+        using result_t = when_any_result<T>;
+
+        if (inputs.empty()) {
+            throw std::invalid_argument("when_any needs at least one future");
+        }
+
+        auto shared = std::make_shared<impl::combinator_state<result_t>>(inputs.size(), inputs.front().get_executor());
+        auto output = shared->output.get_future();
+
+        for (std::size_t i = 0; i < inputs.size(); ++i) {
+            inputs[i].when_ready(inline_executor(), [shared, i](future<T> ready) {
+                if (shared->done.exchange(true, std::memory_order_acq_rel)) {
+                    return;
+                }
+
+                try {
+                    if constexpr (std::is_void_v<T>) {
+                        ready.get();
+                        shared->output.set_value(result_t{ .index = i, .value = {} });
+                    }
+                    else {
+                        shared->output.set_value(result_t{ .index = i, .value = ready.get() });
+                    }
+                }
+                catch (...) {
+                    shared->output.set_exception(std::current_exception());
+                }
+            });
+        }
+
+        return output;
+    }
+
+}    // namespace arti::async
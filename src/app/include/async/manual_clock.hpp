@@ -0,0 +1,42 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#include <async/schedule_policy.hpp>
+
+namespace arti::async {
+
+    // Time for a context that only moves when told to. The context never
+    // sleeps on it, context::advance() walks the timers up to the new time
+    struct manual_clock {
+        using time_point = schedule_policy::impl::timer_clock::time_point;
+        using duration = schedule_policy::impl::timer_clock::duration;
+
+        explicit manual_clock(time_point start = time_point{})
+            : ticks(start.time_since_epoch().count()) { }
+
+        manual_clock(manual_clock &&) = delete;
+        manual_clock &operator=(manual_clock &&) = delete;
+
+        manual_clock(const manual_clock &) = delete;
+        manual_clock &operator=(const manual_clock &) = delete;
+
+        time_point now() const noexcept {
+            return time_point{ duration{ ticks.load(std::memory_order_acquire) } };
+        }
+
+        // Never goes backwards, an earlier point is ignored
+        void set(time_point point) noexcept {
+            auto target = point.time_since_epoch().count();
+            auto current = ticks.load(std::memory_order_relaxed);
+
+            while (current < target and not ticks.compare_exchange_weak(current, target, std::memory_order_acq_rel)) { }
+        }
+
+      private:
+        std::atomic<duration::rep> ticks;
+    };
+
+}    // namespace arti::async
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <bit>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+
+namespace arti::async {
+
+    // Power of two buckets over microseconds, bucket i holds the samples below
+    // 2^i us (the last one everything above). Coarse but cheap to record
+    struct latency_histogram {
+        static constexpr std::size_t bucket_count = 26;
+
+        std::array<uint64_t, bucket_count> buckets{};
+        uint64_t count = 0;
+        std::chrono::nanoseconds total{ 0 };
+        std::chrono::nanoseconds max{ 0 };
+
+        static std::size_t bucket_for(uint64_t ns) noexcept {
+            return std::min<std::size_t>(std::bit_width(ns / 1000), bucket_count - 1);
+        }
+
+        void record(std::chrono::nanoseconds sample) {
+            auto ns = static_cast<uint64_t>(std::max<int64_t>(sample.count(), 0));
+
+            buckets[bucket_for(ns)]++;
+            count++;
+            total += std::chrono::nanoseconds{ ns };
+            max = std::max(max, std::chrono::nanoseconds{ ns });
+        }
+
+        std::chrono::nanoseconds mean() const {
+            return count == 0 ? std::chrono::nanoseconds{ 0 } : total / static_cast<int64_t>(count);
+        }
+
+        // Upper bound of the bucket holding the given fraction of samples
+        std::chrono::microseconds percentile(double fraction) const {
+            auto target = static_cast<uint64_t>(static_cast<double>(count) * fraction);
+            uint64_t seen = 0;
+
+            for (std::size_t i = 0; i < bucket_count; ++i) {
+                seen += buckets[i];
+
+                if (seen > target) {
+                    return std::chrono::microseconds{ uint64_t{ 1 } << i };
+                }
+            }
+
+            return std::chrono::duration_cast<std::chrono::microseconds>(max);
+        }
+
+        latency_histogram &operator+=(const latency_histogram &other) {
+            for (std::size_t i = 0; i < bucket_count; ++i) {
+                buckets[i] += other.buckets[i];
+            }
+
+            count += other.count;
+            total += other.total;
+            max = std::max(max, other.max);
+
+            return *this;
+        }
+    };
+
+    namespace impl {
+
+        // Written by a single thread with relaxed stores, read from anywhere
+        struct atomic_histogram {
+            atomic_histogram()
+                : count(0)
+                , total_ns(0)
+                , max_ns(0) {
+                for (auto &bucket : buckets) {
+                    bucket.store(0, std::memory_order_relaxed);
+                }
+            }
+
+            atomic_histogram(atomic_histogram &&) = delete;
+            atomic_histogram &operator=(atomic_histogram &&) = delete;
+
+            atomic_histogram(const atomic_histogram &) = delete;
+            atomic_histogram &operator=(const atomic_histogram &) = delete;
+
+            void record(std::chrono::nanoseconds sample) {
+                auto ns = static_cast<uint64_t>(std::max<int64_t>(sample.count(), 0));
+                bump(buckets[latency_histogram::bucket_for(ns)], 1);
+                bump(count, 1);
+                bump(total_ns, ns);
+
+                if (ns > max_ns.load(std::memory_order_relaxed)) {
+                    max_ns.store(ns, std::memory_order_relaxed);
+                }
+            }
+
+            void collect(latency_histogram &into) const {
+                latency_histogram mine;
+
+                for (std::size_t i = 0; i < latency_histogram::bucket_count; ++i) {
+                    mine.buckets[i] = buckets[i].load(std::memory_order_relaxed);
+                }
+
+                mine.count = count.load(std::memory_order_relaxed);
+                mine.total = std::chrono::nanoseconds{ total_ns.load(std::memory_order_relaxed) };
+                mine.max = std::chrono::nanoseconds{ max_ns.load(std::memory_order_relaxed) };
+
+                into += mine;
+            }
+
+            // Single writer, a plain load + store is enough and avoids a locked add
+            static void bump(std::atomic_uint64_t &counter, uint64_t amount) {
+                counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+            }
+
+            std::array<std::atomic_uint64_t, latency_histogram::bucket_count> buckets;
+            std::atomic_uint64_t count;
+            std::atomic_uint64_t total_ns;
+            std::atomic_uint64_t max_ns;
+        };
+
+    }    // namespace impl
+
+}    // namespace arti::async
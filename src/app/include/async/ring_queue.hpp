@@ -0,0 +1,123 @@
+#pragma once
+
+#include <new>
+#include <memory>
+#include <cstddef>
+#include <utility>
+#include <optional>
+
+namespace arti::async {
+
+    // Growable FIFO over a single buffer, unlike std::deque it never gives
+    // memory back, so once it reached its peak size pushes don't allocate
+    template <typename T>
+    struct ring_queue {
+        ring_queue()
+            : head(0)
+            , count(0)
+            , capacity(0) { }
+
+        ~ring_queue() {
+            clear();
+        }
+
+        ring_queue(ring_queue &&) = delete;
+        ring_queue &operator=(ring_queue &&) = delete;
+
+        ring_queue(const ring_queue &) = delete;
+        ring_queue &operator=(const ring_queue &) = delete;
+
+        void push_back(T &&item) {
+            if (count == capacity) {
+                grow();
+            }
+
+            std::construct_at(slot((head + count) % capacity), std::move(item));
+            ++count;
+        }
+
+        std::optional<T> pop_front() {
+            if (count == 0) {
+                return std::nullopt;
+            }
+
+            T *item = slot(head);
+            std::optional<T> result{ std::move(*item) };
+            std::destroy_at(item);
+
+            head = (head + 1) % capacity;
+            --count;
+
+            return result;
+        }
+
+        // Takes out the first item pred accepts, the ones behind it move up a
+        // slot so the rest keep their order
+        template <typename Predicate>
+        std::optional<T> extract_first_if(Predicate pred) {
+            for (std::size_t i = 0; i < count; ++i) {
+                T *item = slot((head + i) % capacity);
+
+                if (not pred(*item)) {
+                    continue;
+                }
+
+                std::optional<T> result{ std::move(*item) };
+
+                for (std::size_t j = i; j + 1 < count; ++j) {
+                    *slot((head + j) % capacity) = std::move(*slot((head + j + 1) % capacity));
+                }
+
+                std::destroy_at(slot((head + count - 1) % capacity));
+                --count;
+
+                return result;
+            }
+
+            return std::nullopt;
+        }
+
+        void clear() {
+            while (pop_front()) { }
+        }
+
+        std::size_t size() const {
+            return count;
+        }
+
+        bool empty() const {
+            return count == 0;
+        }
+
+      private:
+        struct alignas(T) raw_slot {
+            std::byte bytes[sizeof(T)];
+        };
+
+        T *slot(std::size_t index) {
+            return std::launder(reinterpret_cast<T *>(buffer[index].bytes));
+        }
+
+        void grow() {
+            auto new_capacity = capacity == 0 ? 16 : capacity * 2;
+            auto new_buffer = std::make_unique<raw_slot[]>(new_capacity);
+
+            for (std::size_t i = 0; i < count; ++i) {
+                T *item = slot((head + i) % capacity);
+                std::construct_at(reinterpret_cast<T *>(new_buffer[i].bytes), std::move(*item));
+                std::destroy_at(item);
+            }
+
+            buffer = std::move(new_buffer);
+            capacity = new_capacity;
+            head = 0;
+        }
+
+        std::unique_ptr<raw_slot[]> buffer;
+
+        std::size_t head;
+        std::size_t count;
+        std::size_t capacity;
+    };
+
+}    // namespace arti::async
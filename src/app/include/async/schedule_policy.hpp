@@ -1,11 +1,30 @@
 #pragma once
 
 #include <chrono>
+#include <random>
+#include <cstdint>
+#include <algorithm>
 
 namespace arti::async {
 
     namespace schedule_policy {
 
+        // What a callback can return instead of bool. Only the backoff policies
+        // look at failure, for the rest it counts as success
+        enum class run_result {
+            success,
+            failure,
+            stop
+        };
+
+        // fixed_delay counts each period from the end of the previous run, so
+        // a slow callback stretches it. fixed_rate keeps deadlines on the grid
+        // laid from the first run, ticks a run overlaps are skipped, not queued
+        enum class timing {
+            fixed_delay,
+            fixed_rate
+        };
+
         namespace impl {
 
             enum class scheduler_action {
@@ -14,9 +33,51 @@ namespace arti::async {
                 cancel
             };
 
+            // Monotonic, a wall clock adjustment must not fire or stall timers.
+            // Only its time_point is used here, the context decides what now
+            // is and hands it to every call so a manual_clock can stand in
+            using timer_clock = std::chrono::steady_clock;
+
             struct init_visitor;
             struct after_visitor;
             struct update_visitor;
+            struct deadline_visitor;
+
+            // Uniform in [low, high], each policy owns its engine so runs of
+            // different tasks never share state
+            inline std::chrono::milliseconds random_between(
+                std::minstd_rand &engine,
+                std::chrono::milliseconds low,
+                std::chrono::milliseconds high
+            ) {
+                std::uniform_int_distribution<std::chrono::milliseconds::rep> dist(low.count(), std::max(low, high).count());
+                return std::chrono::milliseconds{ dist(engine) };
+            }
+
+            // last_update is the previous deadline minus a period, so the next
+            // one is last_update + period
+            inline void advance_after_run(
+                timer_clock::time_point now,
+                timer_clock::time_point &last_update,
+                std::chrono::milliseconds period,
+                timing mode,
+                uint64_t &skipped
+            ) {
+                if (mode == timing::fixed_delay or period <= std::chrono::milliseconds::zero()) {
+                    last_update = now;
+                    return;
+                }
+
+                last_update += period;
+
+                // More than one tick already due, run once and drop the rest
+                auto behind = (now - last_update) / period;
+
+                if (behind > 1) {
+                    skipped += static_cast<uint64_t>(behind - 1);
+                    last_update += (behind - 1) * period;
+                }
+            }
 
         }    // namespace impl
 
@@ -24,6 +85,7 @@ namespace arti::async {
             friend struct impl::init_visitor;
             friend struct impl::after_visitor;
             friend struct impl::update_visitor;
+            friend struct impl::deadline_visitor;
 
             infinity() = default;
             ~infinity() = default;
@@ -35,26 +97,46 @@ namespace arti::async {
             infinity &operator=(const infinity &) = default;
 
           private:
-            void init() { }
+            void init(impl::timer_clock::time_point) { }
 
-            impl::scheduler_action update() {
+            impl::scheduler_action update(impl::timer_clock::time_point) {
                 return impl::scheduler_action::run;
             }
 
-            impl::scheduler_action after() {
+            impl::scheduler_action after(impl::timer_clock::time_point) {
                 return impl::scheduler_action::wait;
             }
+
+            // Due again as soon as the previous run finished
+            impl::timer_clock::time_point next_due() const {
+                return impl::timer_clock::time_point::min();
+            }
         };
 
         struct every {
             friend struct impl::init_visitor;
             friend struct impl::after_visitor;
             friend struct impl::update_visitor;
+            friend struct impl::deadline_visitor;
 
             std::chrono::milliseconds period;
 
-            every(std::chrono::milliseconds period)
-                : period(period) { }
+            // How late a run may start so it shares a wakeup with other timers
+            std::chrono::milliseconds slack;
+
+            timing mode;
+
+            every(
+                std::chrono::milliseconds period,
+                std::chrono::milliseconds slack = std::chrono::milliseconds::zero(),
+                timing mode = timing::fixed_delay
+            )
+                : period(period)
+                , slack(slack)
+                , mode(mode) { }
+
+            every(std::chrono::milliseconds period, timing mode)
+                : every(period, std::chrono::milliseconds::zero(), mode) { }
 
             ~every() = default;
 
@@ -64,15 +146,21 @@ namespace arti::async {
             every(const every &) = default;
             every &operator=(const every &) = default;
 
+            // Fixed rate ticks dropped because a run or the pool fell behind
+            uint64_t skipped_ticks() const noexcept {
+                return skipped;
+            }
+
           private:
-            std::chrono::time_point<std::chrono::high_resolution_clock> last_update;
+            uint64_t skipped;
+            impl::timer_clock::time_point last_update;
 
-            void init() {
-                last_update = std::chrono::high_resolution_clock::now() - period;
+            void init(impl::timer_clock::time_point now) {
+                skipped = 0;
+                last_update = now - period;
             }
 
-            impl::scheduler_action update() {
-                auto now = std::chrono::high_resolution_clock::now();
+            impl::scheduler_action update(impl::timer_clock::time_point now) {
                 auto diff = std::chrono::duration_cast<std::chrono::milliseconds>(now - last_update);
 
                 if (diff >= period) {
@@ -82,16 +170,21 @@ namespace arti::async {
                 return impl::scheduler_action::wait;
             }
 
-            impl::scheduler_action after() {
-                last_update = std::chrono::high_resolution_clock::now();
+            impl::scheduler_action after(impl::timer_clock::time_point now) {
+                impl::advance_after_run(now, last_update, period, mode, skipped);
                 return impl::scheduler_action::wait;
             }
+
+            impl::timer_clock::time_point next_due() const {
+                return last_update + period;
+            }
         };
 
         struct once_after {
             friend struct impl::init_visitor;
             friend struct impl::after_visitor;
             friend struct impl::update_visitor;
+            friend struct impl::deadline_visitor;
 
             std::chrono::milliseconds period;
 
@@ -108,19 +201,18 @@ namespace arti::async {
 
           private:
             bool expired;
-            std::chrono::time_point<std::chrono::high_resolution_clock> last_update;
+            impl::timer_clock::time_point last_update;
 
-            void init() {
+            void init(impl::timer_clock::time_point now) {
                 expired = false;
-                last_update = std::chrono::high_resolution_clock::now();
+                last_update = now;
             }
 
-            impl::scheduler_action update() {
+            impl::scheduler_action update(impl::timer_clock::time_point now) {
                 if (expired) {
                     return impl::scheduler_action::cancel;
                 }
 
-                auto now = std::chrono::high_resolution_clock::now();
                 auto diff = std::chrono::duration_cast<std::chrono::milliseconds>(now - last_update);
 
                 if (diff >= period) {
@@ -130,22 +222,39 @@ namespace arti::async {
                 return impl::scheduler_action::wait;
             }
 
-            impl::scheduler_action after() {
+            impl::scheduler_action after(impl::timer_clock::time_point) {
                 return impl::scheduler_action::cancel;
             }
+
+            impl::timer_clock::time_point next_due() const {
+                return last_update + period;
+            }
         };
 
         struct n_times_every {
             friend struct impl::init_visitor;
             friend struct impl::after_visitor;
             friend struct impl::update_visitor;
+            friend struct impl::deadline_visitor;
 
             std::size_t times;
             std::chrono::milliseconds period;
-
-            n_times_every(std::size_t times, std::chrono::milliseconds period)
+            std::chrono::milliseconds slack;
+            timing mode;
+
+            n_times_every(
+                std::size_t times,
+                std::chrono::milliseconds period,
+                std::chrono::milliseconds slack = std::chrono::milliseconds::zero(),
+                timing mode = timing::fixed_delay
+            )
                 : times(times)
-                , period(period) { }
+                , period(period)
+                , slack(slack)
+                , mode(mode) { }
+
+            n_times_every(std::size_t times, std::chrono::milliseconds period, timing mode)
+                : n_times_every(times, period, std::chrono::milliseconds::zero(), mode) { }
 
             ~n_times_every() = default;
 
@@ -155,19 +264,24 @@ namespace arti::async {
             n_times_every(const n_times_every &) = default;
             n_times_every &operator=(const n_times_every &) = default;
 
+            uint64_t skipped_ticks() const noexcept {
+                return skipped;
+            }
+
           private:
-            std::chrono::time_point<std::chrono::high_resolution_clock> last_update;
+            uint64_t skipped;
+            impl::timer_clock::time_point last_update;
 
-            void init() {
-                last_update = std::chrono::high_resolution_clock::now() - period;
+            void init(impl::timer_clock::time_point now) {
+                skipped = 0;
+                last_update = now - period;
             }
 
-            impl::scheduler_action update() {
+            impl::scheduler_action update(impl::timer_clock::time_point now) {
                 if (times == 0) {
                     return impl::scheduler_action::cancel;
                 }
 
-                auto now = std::chrono::high_resolution_clock::now();
                 auto diff = std::chrono::duration_cast<std::chrono::milliseconds>(now - last_update);
 
                 if (diff >= period) {
@@ -177,69 +291,290 @@ namespace arti::async {
                 return impl::scheduler_action::wait;
             }
 
-            impl::scheduler_action after() {
+            impl::scheduler_action after(impl::timer_clock::time_point now) {
                 if (times == 0)
                     return impl::scheduler_action::cancel;
 
                 --times;
-                last_update = std::chrono::high_resolution_clock::now();
+                impl::advance_after_run(now, last_update, period, mode, skipped);
+
+                return impl::scheduler_action::wait;
+            }
+
+            impl::timer_clock::time_point next_due() const {
+                return last_update + period;
+            }
+        };
+
+        // Runs every period while the callback succeeds. Each failure doubles the
+        // ceiling up to cap and the next delay is drawn from [period, ceiling],
+        // so clients that lost the network together don't retry together. The
+        // first success goes back to period
+        struct exponential_backoff {
+            friend struct impl::init_visitor;
+            friend struct impl::after_visitor;
+            friend struct impl::update_visitor;
+            friend struct impl::deadline_visitor;
+
+            std::chrono::milliseconds period;
+            std::chrono::milliseconds cap;
+            std::chrono::milliseconds slack;
+
+            exponential_backoff(
+                std::chrono::milliseconds period,
+                std::chrono::milliseconds cap,
+                std::chrono::milliseconds slack = std::chrono::milliseconds::zero()
+            )
+                : period(period)
+                , cap(cap)
+                , slack(slack) { }
+
+            ~exponential_backoff() = default;
+
+            exponential_backoff(exponential_backoff &&) = default;
+            exponential_backoff &operator=(exponential_backoff &&) = default;
+
+            exponential_backoff(const exponential_backoff &) = default;
+            exponential_backoff &operator=(const exponential_backoff &) = default;
+
+            // Consecutive failures so far, 0 while healthy
+            std::size_t failures() const noexcept {
+                return failed;
+            }
+
+            // The next deadline moves to the new period from the last run. While
+            // failing the drawn backoff delay is kept, the next one is drawn
+            // from the new period
+            void set_period(std::chrono::milliseconds new_period) noexcept {
+                period = new_period;
+
+                if (failed == 0) {
+                    delay = period;
+                }
+            }
+
+          private:
+            std::size_t failed;
+            std::chrono::milliseconds delay;
+            std::minstd_rand engine;
+            impl::timer_clock::time_point last_update;
+
+            void init(impl::timer_clock::time_point now) {
+                failed = 0;
+                delay = period;
+                engine.seed(std::random_device{}());
+                last_update = now - period;
+            }
+
+            impl::scheduler_action update(impl::timer_clock::time_point now) {
+                auto diff = std::chrono::duration_cast<std::chrono::milliseconds>(now - last_update);
+
+                if (diff >= delay) {
+                    return impl::scheduler_action::run;
+                }
+
+                return impl::scheduler_action::wait;
+            }
+
+            impl::scheduler_action after(run_result result, impl::timer_clock::time_point now) {
+                if (result == run_result::failure) {
+                    ++failed;
+
+                    // Doubling stops once it passes cap, no overflow after many failures
+                    auto ceiling = period;
+
+                    for (std::size_t i = 0; i < failed and ceiling < cap; ++i) {
+                        ceiling *= 2;
+                    }
+
+                    delay = impl::random_between(engine, period, std::min(ceiling, std::max(cap, period)));
+                }
+                else {
+                    failed = 0;
+                    delay = period;
+                }
+
+                last_update = now;
 
                 return impl::scheduler_action::wait;
             }
+
+            impl::timer_clock::time_point next_due() const {
+                return last_update + delay;
+            }
+        };
+
+        // Every delay is drawn from [0, 2 * period], same average rate as every
+        // but many instances started together drift apart instead of hitting
+        // the server in lockstep
+        struct jittered_every {
+            friend struct impl::init_visitor;
+            friend struct impl::after_visitor;
+            friend struct impl::update_visitor;
+            friend struct impl::deadline_visitor;
+
+            std::chrono::milliseconds period;
+
+            jittered_every(std::chrono::milliseconds period)
+                : period(period) { }
+
+            ~jittered_every() = default;
+
+            jittered_every(jittered_every &&) = default;
+            jittered_every &operator=(jittered_every &&) = default;
+
+            jittered_every(const jittered_every &) = default;
+            jittered_every &operator=(const jittered_every &) = default;
+
+            // Draws the delay since the last run again from the new period
+            void set_period(std::chrono::milliseconds new_period) {
+                period = new_period;
+                delay = impl::random_between(engine, std::chrono::milliseconds::zero(), 2 * period);
+            }
+
+          private:
+            std::chrono::milliseconds delay;
+            std::minstd_rand engine;
+            impl::timer_clock::time_point last_update;
+
+            void init(impl::timer_clock::time_point now) {
+                engine.seed(std::random_device{}());
+                delay = impl::random_between(engine, std::chrono::milliseconds::zero(), 2 * period);
+                last_update = now;
+            }
+
+            impl::scheduler_action update(impl::timer_clock::time_point now) {
+                auto diff = std::chrono::duration_cast<std::chrono::milliseconds>(now - last_update);
+
+                if (diff >= delay) {
+                    return impl::scheduler_action::run;
+                }
+
+                return impl::scheduler_action::wait;
+            }
+
+            impl::scheduler_action after(impl::timer_clock::time_point now) {
+                delay = impl::random_between(engine, std::chrono::milliseconds::zero(), 2 * period);
+                last_update = now;
+
+                return impl::scheduler_action::wait;
+            }
+
+            impl::timer_clock::time_point next_due() const {
+                return last_update + delay;
+            }
         };
 
         namespace impl {
             struct update_visitor {
+                timer_clock::time_point now;
+
                 scheduler_action operator()(infinity &p) {
-                    return p.update();
+                    return p.update(now);
                 }
 
                 scheduler_action operator()(every &p) {
-                    return p.update();
+                    return p.update(now);
                 }
 
                 scheduler_action operator()(once_after &p) {
-                    return p.update();
+                    return p.update(now);
                 }
 
                 scheduler_action operator()(n_times_every &p) {
-                    return p.update();
+                    return p.update(now);
+                }
+
+                scheduler_action operator()(exponential_backoff &p) {
+                    return p.update(now);
+                }
+
+                scheduler_action operator()(jittered_every &p) {
+                    return p.update(now);
                 }
             };
 
             struct after_visitor {
+                run_result result;
+                timer_clock::time_point now;
+
                 scheduler_action operator()(infinity &p) {
-                    return p.after();
+                    return p.after(now);
                 }
 
                 scheduler_action operator()(every &p) {
-                    return p.after();
+                    return p.after(now);
                 }
 
                 scheduler_action operator()(once_after &p) {
-                    return p.after();
+                    return p.after(now);
                 }
 
                 scheduler_action operator()(n_times_every &p) {
-                    return p.after();
+                    return p.after(now);
+                }
+
+                scheduler_action operator()(exponential_backoff &p) {
+                    return p.after(result, now);
+                }
+
+                scheduler_action operator()(jittered_every &p) {
+                    return p.after(now);
+                }
+            };
+
+            // When update() is going to say run next, the context sleeps until then
+            struct deadline_visitor {
+                timer_clock::time_point operator()(const infinity &p) {
+                    return p.next_due();
+                }
+
+                timer_clock::time_point operator()(const every &p) {
+                    return p.next_due();
+                }
+
+                timer_clock::time_point operator()(const once_after &p) {
+                    return p.next_due();
+                }
+
+                timer_clock::time_point operator()(const n_times_every &p) {
+                    return p.next_due();
+                }
+
+                timer_clock::time_point operator()(const exponential_backoff &p) {
+                    return p.next_due();
+                }
+
+                timer_clock::time_point operator()(const jittered_every &p) {
+                    return p.next_due();
                 }
             };
 
             struct init_visitor {
+                timer_clock::time_point now;
+
                 void operator()(infinity &p) {
-                    return p.init();
+                    return p.init(now);
                 }
 
                 void operator()(every &p) {
-                    return p.init();
+                    return p.init(now);
                 }
 
                 void operator()(once_after &p) {
-                    return p.init();
+                    return p.init(now);
                 }
 
                 void operator()(n_times_every &p) {
-                    return p.init();
+                    return p.init(now);
+                }
+
+                void operator()(exponential_backoff &p) {
+                    return p.init(now);
+                }
+
+                void operator()(jittered_every &p) {
+                    return p.init(now);
                 }
             };
 
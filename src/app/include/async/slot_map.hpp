@@ -0,0 +1,180 @@
+#pragma once
+
+#include <array>
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+#include <optional>
+
+namespace arti::async {
+
+    // Index in the low half, generation in the high one. A slot's generation is
+    // bumped every time it is freed, so a handle to something erased never
+    // matches whatever reuses the slot. 0 is never handed out
+    struct slot_handle {
+        uint64_t value = 0;
+
+        uint32_t index() const noexcept {
+            return static_cast<uint32_t>(value);
+        }
+
+        uint32_t generation() const noexcept {
+            return static_cast<uint32_t>(value >> 32);
+        }
+
+        explicit operator bool() const noexcept {
+            return value != 0;
+        }
+
+        friend bool operator==(slot_handle, slot_handle) = default;
+    };
+
+    // Values live in fixed size chunks that are never moved, so a pointer to
+    // one stays valid until it is erased no matter how many are inserted after.
+    // Insert, find and erase are O(1), iteration walks a dense list of live
+    // slots instead of every slot ever allocated
+    template <typename T, std::size_t ChunkSize = 256>
+    struct slot_map {
+        slot_map()
+            : free_head(no_slot) { }
+
+        slot_map(slot_map &&) = delete;
+        slot_map &operator=(slot_map &&) = delete;
+
+        slot_map(const slot_map &) = delete;
+        slot_map &operator=(const slot_map &) = delete;
+
+        template <typename... Args>
+        std::pair<slot_handle, T *> emplace(Args &&...args) {
+            auto index = acquire_slot();
+            auto &target = slot_at(index);
+
+            target.value.emplace(std::forward<Args>(args)...);
+            target.dense_index = static_cast<uint32_t>(dense.size());
+            dense.push_back(index);
+
+            return { make_handle(index, target.generation), &*target.value };
+        }
+
+        T *find(slot_handle handle) noexcept {
+            auto index = handle.index();
+
+            if (index >= slot_count() or not handle) {
+                return nullptr;
+            }
+
+            auto &target = slot_at(index);
+
+            if (target.generation != handle.generation() or not target.value) {
+                return nullptr;
+            }
+
+            return &*target.value;
+        }
+
+        bool erase(slot_handle handle) {
+            if (find(handle) == nullptr) {
+                return false;
+            }
+
+            auto index = handle.index();
+            auto &target = slot_at(index);
+
+            // Swap with the last live slot so dense stays packed
+            auto moved = dense.back();
+            dense[target.dense_index] = moved;
+            slot_at(moved).dense_index = target.dense_index;
+            dense.pop_back();
+
+            target.value.reset();
+
+            // Generation 0 would let the handle be 0 for slot 0, skip it
+            if (++target.generation == 0) {
+                target.generation = 1;
+            }
+
+            target.next_free = free_head;
+            free_head = index;
+
+            return true;
+        }
+
+        // f(handle, value) for every live value, it must not insert or erase
+        template <typename F>
+        void for_each(F &&f) {
+            for (auto index : dense) {
+                auto &target = slot_at(index);
+                f(make_handle(index, target.generation), *target.value);
+            }
+        }
+
+        template <typename F>
+        void for_each(F &&f) const {
+            for (auto index : dense) {
+                const auto &target = slot_at(index);
+                f(make_handle(index, target.generation), *target.value);
+            }
+        }
+
+        std::size_t size() const noexcept {
+            return dense.size();
+        }
+
+        bool empty() const noexcept {
+            return dense.empty();
+        }
+
+      private:
+        static constexpr uint32_t no_slot = UINT32_MAX;
+
+        struct slot {
+            std::optional<T> value;
+            uint32_t generation = 1;
+            uint32_t next_free = no_slot;
+            uint32_t dense_index = 0;
+        };
+
+        using chunk = std::array<slot, ChunkSize>;
+
+        static slot_handle make_handle(uint32_t index, uint32_t generation) {
+            return { (static_cast<uint64_t>(generation) << 32) | index };
+        }
+
+        std::size_t slot_count() const noexcept {
+            return chunks.size() * ChunkSize;
+        }
+
+        slot &slot_at(uint32_t index) {
+            return (*chunks[index / ChunkSize])[index % ChunkSize];
+        }
+
+        const slot &slot_at(uint32_t index) const {
+            return (*chunks[index / ChunkSize])[index % ChunkSize];
+        }
+
+        uint32_t acquire_slot() {
+            if (free_head == no_slot) {
+                auto first = static_cast<uint32_t>(slot_count());
+                chunks.push_back(std::make_unique<chunk>());
+
+                // Thread the new slots in order so low indices are reused first
+                for (std::size_t i = ChunkSize; i-- > 0;) {
+                    (*chunks.back())[i].next_free = free_head;
+                    free_head = first + static_cast<uint32_t>(i);
+                }
+            }
+
+            auto index = free_head;
+            free_head = slot_at(index).next_free;
+
+            return index;
+        }
+
+        std::vector<std::unique_ptr<chunk>> chunks;
+        std::vector<uint32_t> dense;
+        uint32_t free_head;
+    };
+
+}    // namespace arti::async
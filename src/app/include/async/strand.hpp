@@ -0,0 +1,167 @@
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <algorithm>
+#include <coroutine>
+#include <exception>
+
+#include <spdlog/spdlog.h>
+
+#include <async/executor.hpp>
+#include <async/thread_pool.hpp>
+
+namespace arti::async {
+
+    // Jobs posted to a strand run one at a time in the order they were posted,
+    // on whichever pool worker picks the strand up. It has no thread of its own,
+    // at most one drain of it is ever queued on the pool
+    struct strand {
+        explicit strand(thread_pool &target, priority prio = priority::normal)
+            : pool(&target)
+            , lane(prio)
+            , scheduled(false) { }
+
+        strand(strand &&) = delete;
+        strand &operator=(strand &&) = delete;
+
+        strand(const strand &) = delete;
+        strand &operator=(const strand &) = delete;
+
+        void post(job_t &&job) {
+            enqueue({ std::string{}, std::move(job) });
+        }
+
+        // A job with the same key still waiting is dropped and this one goes to
+        // the back, so whatever was posted in between keeps running before it
+        void post(coalesce_key key, job_t &&job) {
+            enqueue({ std::move(key.value), std::move(job) });
+        }
+
+        // co_await strand.schedule() continues the coroutine on the strand. It
+        // only holds the strand until it suspends again
+        struct schedule_operation {
+            strand *target;
+
+            bool await_ready() const noexcept {
+                return false;
+            }
+
+            void await_suspend(std::coroutine_handle<> handle) const {
+                target->post([handle] {
+                    handle.resume();
+                });
+            }
+
+            void await_resume() const noexcept { }
+        };
+
+        schedule_operation schedule() noexcept {
+            return { this };
+        }
+
+      private:
+        struct entry {
+            std::string key;
+            job_t job;
+        };
+
+        // Jobs run before the drain goes back to the pool, so a busy strand
+        // doesn't keep a worker from everything else
+        static constexpr std::size_t drain_batch = 16;
+
+        void enqueue(entry &&item) {
+            {
+                std::scoped_lock lock(mtx);
+
+                if (not item.key.empty()) {
+                    std::erase_if(queue, [&](const entry &queued) {
+                        return queued.key == item.key;
+                    });
+                }
+
+                queue.push_back(std::move(item));
+
+                if (std::exchange(scheduled, true)) {
+                    return;
+                }
+            }
+
+            schedule_drain();
+        }
+
+        void schedule_drain() {
+            pool->post(lane, drain_job{ this });
+        }
+
+        // Queued on the pool for a drain. Destroyed without running (the pool
+        // stopped with it still queued) it clears scheduled, so the next post
+        // queues a new drain instead of the strand being stuck
+        struct drain_job {
+            explicit drain_job(strand *target)
+                : target(target) { }
+
+            drain_job(drain_job &&other) noexcept
+                : target(std::exchange(other.target, nullptr)) { }
+
+            drain_job &operator=(drain_job &&) = delete;
+
+            drain_job(const drain_job &) = delete;
+            drain_job &operator=(const drain_job &) = delete;
+
+            ~drain_job() {
+                if (target) {
+                    std::scoped_lock lock(target->mtx);
+                    target->scheduled = false;
+                }
+            }
+
+            void operator()() {
+                std::exchange(target, nullptr)->drain();
+            }
+
+            strand *target;
+        };
+
+        void drain() {
+            for (std::size_t ran = 0; ran < drain_batch; ++ran) {
+                job_t job;
+
+                {
+                    std::scoped_lock lock(mtx);
+
+                    if (queue.empty()) {
+                        scheduled = false;
+                        return;
+                    }
+
+                    job = std::move(queue.front().job);
+                    queue.pop_front();
+                }
+
+                // A throwing job must not leave the strand marked as scheduled
+                try {
+                    job();
+                }
+                catch (std::exception &exc) {
+                    spdlog::error(fmt::format("Unhandled exception in strand job: '{}'", exc.what()));
+                }
+                catch (...) {
+                    spdlog::error("Unhandled exception in strand job");
+                }
+            }
+
+            schedule_drain();
+        }
+
+        thread_pool *pool;
+        priority lane;
+
+        std::mutex mtx;
+        std::deque<entry> queue;
+        bool scheduled;
+    };
+
+}    // namespace arti::async
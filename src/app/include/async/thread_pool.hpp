@@ -1,27 +1,142 @@
 #pragma once
 
-#include <list>
+#include <array>
 #include <mutex>
-#include <queue>
 #include <atomic>
-#include <future>
+#include <chrono>
 #include <memory>
+#include <string>
 #include <thread>
+#include <vector>
 #include <cstdint>
+#include <optional>
+#include <coroutine>
+#include <exception>
+#include <algorithm>
 #include <functional>
 #include <type_traits>
+#include <unordered_map>
+#include <memory_resource>
 #include <condition_variable>
 
+#include <spdlog/spdlog.h>
+
 #include <error.hpp>
 
+#include <async/future.hpp>
+#include <async/metrics.hpp>
+#include <async/executor.hpp>
+#include <async/ring_queue.hpp>
+#include <async/unique_function.hpp>
+#include <async/work_stealing_deque.hpp>
+
 namespace arti::async {
 
+    // Interactive is meant for work triggered by the user (button presses),
+    // background for bulk transfers and decoding that nobody is waiting on
+    enum class priority : uint8_t {
+        interactive,
+        normal,
+        background
+    };
+
+    // What a submission does once the queue is at capacity. coalesce only lets
+    // in submissions that replace a queued task with the same coalesce_key
+    enum class overload_policy : uint8_t {
+        block,
+        reject,
+        drop_oldest,
+        coalesce
+    };
+
+    // Queued tasks sharing a key are merged, the latest submission replaces the
+    // one still waiting (e.g. several seeks while the network is slow)
+    struct coalesce_key {
+        std::string value;
+    };
+
+    struct thread_pool_options {
+        // Queued tasks allowed at once, 0 means unbounded
+        std::size_t capacity = 0;
+        overload_policy on_overload = overload_policy::block;
+
+        // Workers the pool may grow to while every worker is stuck in a blocking
+        // call, 0 keeps it at its initial size
+        std::size_t max_threads = 0;
+
+        // How long every worker has to be running the same task before another
+        // one is added, and how long an extra worker may sit idle before it exits
+        std::chrono::milliseconds blocked_threshold{ 200 };
+        std::chrono::milliseconds idle_timeout{ 30000 };
+    };
+
     struct thread_pool {
+        // Big enough for the player callbacks plus their bound arguments, so
+        // submitting them doesn't touch the heap
+        static constexpr std::size_t inline_task_size = 112;
+
+        using task_t = unique_function<void(), inline_task_size>;
+
+        // Every starvation_interval picks a worker looks at the lower lanes first,
+        // so a stream of interactive tasks can't starve the rest forever
+        static constexpr std::size_t starvation_interval = 8;
+        static constexpr std::size_t priority_count = 3;
+
+        // Scratch memory each worker keeps inline before falling back to its
+        // own chunk pool
+        static constexpr std::size_t arena_size = 16 * 1024;
+
+        struct queue_stats {
+            std::size_t depth;
+            std::size_t high_water;
+
+            uint64_t rejected;
+            uint64_t dropped;
+            uint64_t coalesced;
+        };
+
+        struct worker_stats {
+            // Time spent running tasks and parked waiting for one
+            std::chrono::nanoseconds busy;
+            std::chrono::nanoseconds idle;
+
+            uint64_t tasks_executed;
+
+            // Tasks sitting in its deques and inbox right now
+            std::size_t queued;
+        };
+
+        struct pool_stats {
+            queue_stats queue;
+
+            // Every slot up to max_threads, only the first live_workers have a thread
+            std::size_t live_workers;
+            std::vector<worker_stats> workers;
+
+            // From submission until a worker picked the task up, and how long it ran
+            latency_histogram queue_wait;
+            latency_histogram run_time;
+        };
+
         thread_pool()
             : thread_pool(std::thread::hardware_concurrency()) { }
 
-        explicit thread_pool(uint8_t num_threads)
-            : size(num_threads)
+        // num_threads is also the floor the pool shrinks back to once idle
+        explicit thread_pool(std::size_t num_threads, thread_pool_options opts = {})
+            : min_workers(num_threads == 0 ? 1 : num_threads)
+            , max_workers(std::max(min_workers, opts.max_threads))
+            , options(opts)
+            , live(0)
+            , running_background(0)
+            , pending(0)
+            , high_water(0)
+            , space_epoch(0)
+            , blocked_submitters(0)
+            , rejected(0)
+            , dropped(0)
+            , coalesced(0)
+            , next_inbox(0)
+            , wake_epoch(0)
             , stop_requested(false) { }
 
         ~thread_pool() {
@@ -37,102 +152,876 @@ namespace arti::async {
         thread_pool &operator=(const thread_pool &) = delete;
 
         void initialize() {
-            for (uint8_t i = 0; i < size; ++i) {
-                pool.emplace_back(std::bind_front(&thread_pool::scheduler_loop, this));
+            // Slots are allocated up front, growing only starts a thread on one
+            for (std::size_t i = 0; i < max_workers; ++i) {
+                workers.push_back(std::make_unique<worker>());
+            }
+
+            pool.resize(max_workers);
+
+            for (std::size_t i = 0; i < min_workers; ++i) {
+                start_worker(i);
+            }
+
+            if (max_workers > min_workers) {
+                supervisor = std::thread(std::bind_front(&thread_pool::supervise, this));
             }
         }
 
         void join() {
             {
-                std::unique_lock lock(tasks_mtx);
+                std::scoped_lock lock(supervisor_mtx);
                 stop_requested = true;
             }
 
-            tasks_cndtn.notify_all();
+            supervisor_cv.notify_all();
+            wake_all();
+
+            // Release submitters blocked on a full queue, they get rejected
+            space_epoch.fetch_add(1, std::memory_order_release);
+            space_epoch.notify_all();
 
-            for (auto &worker : pool) {
-                worker.join();
+            if (supervisor.joinable()) {
+                supervisor.join();
             }
 
-            pool.clear();
+            for (auto &thread : pool) {
+                if (thread.joinable()) {
+                    thread.join();
+                }
+            }
+        }
+
+        // Index of the worker running the calling thread, std::nullopt when the
+        // caller is not one of this pool's workers
+        std::optional<std::size_t> current_worker() const {
+            if (this_worker.owner != this) {
+                return std::nullopt;
+            }
+
+            return this_worker.index;
+        }
+
+        // Memory for temporaries that die before the running task returns (request
+        // paths, formatting buffers), it is released after every task. Nothing
+        // allocated here may be kept across a co_await or handed to another
+        // thread. Outside of a worker it is the default resource
+        static std::pmr::memory_resource *task_arena() noexcept {
+            if (this_worker.arena == nullptr) {
+                return std::pmr::get_default_resource();
+            }
+
+            return this_worker.arena;
+        }
+
+        queue_stats queue_statistics() const {
+            return {
+                .depth = pending.load(std::memory_order_relaxed),
+                .high_water = high_water.load(std::memory_order_relaxed),
+                .rejected = rejected.load(std::memory_order_relaxed),
+                .dropped = dropped.load(std::memory_order_relaxed),
+                .coalesced = coalesced.load(std::memory_order_relaxed)
+            };
+        }
+
+        // Counters are read without stopping the workers, so values taken from
+        // different workers may be a few tasks apart
+        pool_stats statistics() const {
+            pool_stats snapshot{
+                .queue = queue_statistics(),
+                .live_workers = live.load(std::memory_order_relaxed),
+                .workers = {},
+                .queue_wait = {},
+                .run_time = {}
+            };
+
+            for (const auto &wrk : workers) {
+                std::size_t queued = 0;
+
+                for (const auto &deque : wrk->local) {
+                    queued += deque.size();
+                }
+
+                {
+                    std::scoped_lock lock(wrk->inbox_mtx);
+
+                    for (const auto &lane : wrk->inbox) {
+                        queued += lane.size();
+                    }
+                }
+
+                snapshot.workers.push_back({
+                    .busy = std::chrono::nanoseconds{ wrk->busy_ns.load(std::memory_order_relaxed) },
+                    .idle = std::chrono::nanoseconds{ wrk->idle_ns.load(std::memory_order_relaxed) },
+                    .tasks_executed = wrk->executed.load(std::memory_order_relaxed),
+                    .queued = queued
+                });
+
+                wrk->queue_wait.collect(snapshot.queue_wait);
+                wrk->run_time.collect(snapshot.run_time);
+            }
+
+            return snapshot;
+        }
+
+        // Executor entry point used by futures and coroutines. Continuations are
+        // not subject to capacity, they belong to work that was already admitted
+        void post(job_t &&job) {
+            post(priority::normal, std::move(job));
+        }
+
+        void post(priority prio, job_t &&job) {
+            pending.fetch_add(1, std::memory_order_acq_rel);
+            enqueue(std::move(job), prio, std::nullopt, false);
+        }
+
+        // Awaitable that moves the awaiting coroutine onto one of the workers
+        struct schedule_operation {
+            thread_pool *pool;
+            priority prio;
+
+            bool await_ready() const noexcept {
+                return false;
+            }
+
+            void await_suspend(std::coroutine_handle<> handle) const {
+                pool->post(prio, [handle] {
+                    handle.resume();
+                });
+            }
+
+            void await_resume() const noexcept { }
+        };
+
+        schedule_operation schedule(priority prio = priority::normal) noexcept {
+            return { this, prio };
         }
 
         template <typename TaskCallback, typename... Args>
         auto run_async(TaskCallback &&callback, Args &&...args)
-            -> std::future<std::invoke_result_t<TaskCallback, Args...>> {
-            using return_t = std::invoke_result_t<TaskCallback, Args...>;
-
-            auto task = std::make_shared<std::packaged_task<return_t()>>(
-                std::bind(
-                    std::forward<TaskCallback>(callback),
-                    std::forward<Args>(args)...
-                )
+            -> expected<future<std::invoke_result_t<std::decay_t<TaskCallback>, std::decay_t<Args>...>>> {
+            return run_async_on(
+                std::nullopt,
+                priority::normal,
+                std::forward<TaskCallback>(callback),
+                std::forward<Args>(args)...
             );
+        }
 
-            std::future<return_t> task_future = task->get_future();
+        template <typename TaskCallback, typename... Args>
+        auto run_async(priority prio, TaskCallback &&callback, Args &&...args)
+            -> expected<future<std::invoke_result_t<std::decay_t<TaskCallback>, std::decay_t<Args>...>>> {
+            return run_async_on(
+                std::nullopt,
+                prio,
+                std::forward<TaskCallback>(callback),
+                std::forward<Args>(args)...
+            );
+        }
 
-            {
-                std::unique_lock lck(tasks_mtx);
-                tasks.emplace([task]() { (*task)(); });
-            }
+        // Same as run_async but the task is queued on the given worker instead of
+        // the caller's, it may still be stolen if that worker is busy
+        template <typename TaskCallback, typename... Args>
+        auto run_async_on(
+            std::optional<std::size_t> worker_hint,
+            priority prio,
+            TaskCallback &&callback,
+            Args &&...args
+        ) -> expected<future<std::invoke_result_t<std::decay_t<TaskCallback>, std::decay_t<Args>...>>> {
+            using return_t = std::invoke_result_t<std::decay_t<TaskCallback>, std::decay_t<Args>...>;
 
-            tasks_cndtn.notify_one();
+            // Continuations on the future default to this pool
+            promise<return_t> task_promise{ *this };
+            auto task_future = task_promise.get_future();
+
+            auto submitted = submit(
+                [prms = std::move(task_promise),
+                 cback = std::forward<TaskCallback>(callback),
+                 ... args = std::forward<Args>(args)]() mutable {
+                    try {
+                        if constexpr (std::is_void_v<return_t>) {
+                            std::invoke(std::move(cback), std::move(args)...);
+                            prms.set_value();
+                        }
+                        else {
+                            prms.set_value(std::invoke(std::move(cback), std::move(args)...));
+                        }
+                    }
+                    catch (...) {
+                        prms.set_exception(std::current_exception());
+                    }
+                },
+                prio,
+                worker_hint
+            );
+
+            if (not submitted) {
+                return error<>{ submitted.error() };
+            }
 
             return task_future;
         }
 
         template <typename TaskCallback, typename... Args>
-        void run_and_ignore(TaskCallback &&callback, Args &&...args) {
-            using return_t = std::invoke_result_t<TaskCallback, Args...>;
-
-            auto task = std::make_shared<std::packaged_task<return_t()>>(
-                std::bind(
-                    std::forward<TaskCallback>(callback),
-                    std::forward<Args>(args)...
-                )
+        expected<> run_and_ignore(TaskCallback &&callback, Args &&...args) {
+            return run_and_ignore(
+                priority::normal,
+                std::forward<TaskCallback>(callback),
+                std::forward<Args>(args)...
             );
+        }
 
-            {
-                std::unique_lock lck(tasks_mtx);
-                tasks.emplace([task]() { (*task)(); });
-            }
+        template <typename TaskCallback, typename... Args>
+        expected<> run_and_ignore(priority prio, TaskCallback &&callback, Args &&...args) {
+            return submit(
+                make_ignored_task(std::forward<TaskCallback>(callback), std::forward<Args>(args)...),
+                prio,
+                std::nullopt
+            );
+        }
 
-            tasks_cndtn.notify_one();
+        template <typename TaskCallback, typename... Args>
+        expected<> run_and_ignore(coalesce_key key, priority prio, TaskCallback &&callback, Args &&...args) {
+            return submit_keyed(
+                std::move(key.value),
+                make_ignored_task(std::forward<TaskCallback>(callback), std::forward<Args>(args)...),
+                prio
+            );
         }
 
       private:
-        void scheduler_loop() {
-            std::function<void()> task;
+        template <typename TaskCallback, typename... Args>
+        static task_t make_ignored_task(TaskCallback &&callback, Args &&...args) {
+            return [cback = std::forward<TaskCallback>(callback),
+                    ... args = std::forward<Args>(args)]() mutable {
+                try {
+                    (void) std::invoke(std::move(cback), std::move(args)...);
+                }
+                catch (std::exception &exc) {
+                    spdlog::error(fmt::format("Unhandled exception in pool task: '{}'", exc.what()));
+                }
+                catch (...) {
+                    spdlog::error("Unhandled exception in pool task");
+                }
+            };
+        }
 
-            while (true) {
-                {
-                    std::unique_lock lck(tasks_mtx);
+        // Tasks pushed on a worker deque live in nodes that are recycled, a node
+        // is always handed back to the free list of the worker that created it
+        struct task_node {
+            task_t task;
+            std::chrono::steady_clock::time_point queued_at;
+            std::size_t owner;
+            task_node *next;
+        };
+
+        struct queued_task {
+            task_t task;
+            std::chrono::steady_clock::time_point queued_at;
+
+            // Went through admit(), drop_oldest() may throw it away. Jobs from
+            // post() are strand drains and coroutine resumes, losing one would
+            // wedge the strand or leak the coroutine frame
+            bool evictable;
+        };
+
+        struct worker {
+            worker()
+                : picks(0)
+                , free_nodes(nullptr)
+                , returned_nodes(nullptr)
+                , inboxed(0)
+                , running_since(0)
+                , parked_since(0)
+                , retiring(false)
+                , busy_ns(0)
+                , idle_ns(0)
+                , executed(0)
+                , arena(arena_buffer.data(), arena_buffer.size(), &arena_chunks) { }
+
+            ~worker() {
+                for (auto *node : { free_nodes, returned_nodes.load() }) {
+                    while (node) {
+                        delete std::exchange(node, node->next);
+                    }
+                }
+            }
+
+            std::array<work_stealing_deque<task_node *>, priority_count> local;
+
+            // Only touched by the owner
+            std::size_t picks;
+            task_node *free_nodes;
+
+            // Thieves push executed nodes here, the owner takes the whole list at once
+            std::atomic<task_node *> returned_nodes;
+
+            mutable std::mutex inbox_mtx;
+            std::array<ring_queue<queued_task>, priority_count> inbox;
+
+            // Across all lanes, lets thieves skip empty inboxes without locking
+            std::atomic_size_t inboxed;
+
+            // Steady clock ticks, 0 while not running a task / not parked. The
+            // supervisor reads them to decide when to grow or shrink
+            std::atomic_int64_t running_since;
+            std::atomic_int64_t parked_since;
+
+            std::atomic_bool retiring;
+
+            // Written only by the owner, read by statistics()
+            std::atomic_uint64_t busy_ns;
+            std::atomic_uint64_t idle_ns;
+            std::atomic_uint64_t executed;
+
+            impl::atomic_histogram queue_wait;
+            impl::atomic_histogram run_time;
+
+            // Only used by the owner, so neither needs locking. Overflow chunks go
+            // back to arena_chunks on release and are reused by the next task
+            std::array<std::byte, arena_size> arena_buffer;
+            std::pmr::unsynchronized_pool_resource arena_chunks;
+            std::pmr::monotonic_buffer_resource arena;
+        };
+
+        struct worker_slot {
+            const thread_pool *owner;
+            std::size_t index;
+            std::pmr::memory_resource *arena;
+        };
+
+        task_node *acquire_node(std::size_t index, task_t &&task) {
+            auto &self = *workers[index];
+            auto now = std::chrono::steady_clock::now();
 
-                    tasks_cndtn.wait(lck, [&] {
-                        return stop_requested || !tasks.empty();
-                    });
+            if (not self.free_nodes) {
+                self.free_nodes = self.returned_nodes.exchange(nullptr, std::memory_order_acquire);
+            }
+
+            if (not self.free_nodes) {
+                return new task_node{ .task = std::move(task), .queued_at = now, .owner = index, .next = nullptr };
+            }
+
+            auto *node = std::exchange(self.free_nodes, self.free_nodes->next);
+            node->task = std::move(task);
+            node->queued_at = now;
+
+            return node;
+        }
+
+        void release_node(std::size_t index, task_node *node) {
+            node->task.reset();
 
-                    if (stop_requested && tasks.empty()) {
+            if (node->owner == index) {
+                node->next = workers[index]->free_nodes;
+                workers[index]->free_nodes = node;
+                return;
+            }
+
+            return_node(node);
+        }
+
+        // Hands a node back to its owner from any other thread
+        void return_node(task_node *node) {
+            node->task.reset();
+
+            auto &owner = workers[node->owner]->returned_nodes;
+            node->next = owner.load(std::memory_order_relaxed);
+
+            while (not owner.compare_exchange_weak(
+                node->next, node,
+                std::memory_order_release,
+                std::memory_order_relaxed
+            )) { }
+        }
+
+        // Takes a slot in the queue, applying the overload policy when it is full.
+        // Workers are never blocked, waiting on themselves would deadlock the pool
+        expected<> admit() {
+            auto queued = pending.load(std::memory_order_relaxed);
+
+            while (true) {
+                if (options.capacity == 0 or queued < options.capacity) {
+                    if (pending.compare_exchange_weak(queued, queued + 1, std::memory_order_acq_rel)) {
                         break;
                     }
 
-                    task = tasks.front();
-                    tasks.pop();
+                    continue;
+                }
+
+                if (stop_requested) {
+                    rejected.fetch_add(1, std::memory_order_relaxed);
+                    return error<>{ "Thread pool is stopping" };
+                }
+
+                if (options.on_overload == overload_policy::block and not current_worker()) {
+                    auto epoch = space_epoch.load(std::memory_order_acquire);
+
+                    blocked_submitters.fetch_add(1);
+
+                    // Pairs with leave_queue, either it sees this submitter or this
+                    // submitter sees the slot it freed
+                    if (pending.load() >= options.capacity and not stop_requested) {
+                        space_epoch.wait(epoch, std::memory_order_acquire);
+                    }
+
+                    blocked_submitters.fetch_sub(1);
+
+                    queued = pending.load(std::memory_order_relaxed);
+                    continue;
                 }
 
-                task();
+                if (options.on_overload == overload_policy::drop_oldest and drop_oldest()) {
+                    queued = pending.load(std::memory_order_relaxed);
+                    continue;
+                }
+
+                if (options.on_overload == overload_policy::block) {
+                    queued = pending.fetch_add(1, std::memory_order_acq_rel);
+                    break;
+                }
+
+                rejected.fetch_add(1, std::memory_order_relaxed);
+                return error<>{ fmt::format("Task queue is full ({} tasks)", options.capacity) };
             }
+
+            auto peak = high_water.load(std::memory_order_relaxed);
+
+            while (queued + 1 > peak and not high_water.compare_exchange_weak(peak, queued + 1)) { }
+
+            return {};
         }
 
-        uint8_t size;
+        // A task left the queue, either to run or because it was dropped
+        void leave_queue() {
+            pending.fetch_sub(1);
+
+            if (blocked_submitters.load() > 0) {
+                space_epoch.fetch_add(1, std::memory_order_release);
+                space_epoch.notify_all();
+            }
+        }
+
+        // Throws away the admitted task that waited the longest, looking at the
+        // lowest priority first. Its future, if any, gets a broken promise
+        bool drop_oldest() {
+            for (auto lane = priority_count; lane-- > 0;) {
+                for (auto &target : workers) {
+                    std::optional<queued_task> victim;
+
+                    {
+                        std::scoped_lock lock(target->inbox_mtx);
 
-        std::mutex tasks_mtx;
-        std::condition_variable tasks_cndtn;
+                        victim = target->inbox[lane].extract_first_if([](const queued_task &queued) {
+                            return queued.evictable;
+                        });
 
+                        if (victim) {
+                            target->inboxed.fetch_sub(1, std::memory_order_relaxed);
+                        }
+                    }
+
+                    // Destroyed outside the lock, a broken promise may post its
+                    // continuation to this same inbox
+                    if (victim) {
+                        dropped.fetch_add(1, std::memory_order_relaxed);
+                        leave_queue();
+                        return true;
+                    }
+                }
+            }
+
+            return false;
+        }
+
+        expected<> submit(task_t &&task, priority prio, std::optional<std::size_t> worker_hint) {
+            if (auto ok = admit(); not ok) {
+                return ok;
+            }
+
+            enqueue(std::move(task), prio, worker_hint, true);
+
+            return {};
+        }
+
+        expected<> submit_keyed(std::string key, task_t &&task, priority prio) {
+            {
+                std::scoped_lock lock(keyed_mtx);
+
+                if (auto it = keyed_tasks.find(key); it != keyed_tasks.end()) {
+                    it->second = std::move(task);
+                    coalesced.fetch_add(1, std::memory_order_relaxed);
+                    return {};
+                }
+            }
+
+            if (auto ok = admit(); not ok) {
+                return ok;
+            }
+
+            {
+                std::scoped_lock lock(keyed_mtx);
+
+                // Someone else queued the same key while this one was admitted
+                if (auto it = keyed_tasks.find(key); it != keyed_tasks.end()) {
+                    it->second = std::move(task);
+                    coalesced.fetch_add(1, std::memory_order_relaxed);
+                    leave_queue();
+                    return {};
+                }
+
+                keyed_tasks.emplace(key, std::move(task));
+            }
+
+            enqueue(keyed_trampoline{ this, std::move(key) }, prio, std::nullopt, true);
+
+            return {};
+        }
+
+        // Queued in place of a keyed task, runs whatever was submitted last under
+        // that key. If it gets dropped the key is released so it can be reused
+        struct keyed_trampoline {
+            keyed_trampoline(thread_pool *pool, std::string key)
+                : pool(pool)
+                , key(std::move(key)) { }
+
+            keyed_trampoline(keyed_trampoline &&other) noexcept
+                : pool(std::exchange(other.pool, nullptr))
+                , key(std::move(other.key)) { }
+
+            keyed_trampoline &operator=(keyed_trampoline &&) = delete;
+
+            keyed_trampoline(const keyed_trampoline &) = delete;
+            keyed_trampoline &operator=(const keyed_trampoline &) = delete;
+
+            ~keyed_trampoline() {
+                if (pool) {
+                    (void) std::exchange(pool, nullptr)->take_keyed(key);
+                }
+            }
+
+            void operator()() {
+                // Empty when the key was already released, nothing left to run
+                if (auto latest = std::exchange(pool, nullptr)->take_keyed(key)) {
+                    latest();
+                }
+            }
+
+            thread_pool *pool;
+            std::string key;
+        };
+
+        task_t take_keyed(const std::string &key) {
+            std::scoped_lock lock(keyed_mtx);
+
+            auto node = keyed_tasks.extract(key);
+
+            if (node.empty()) {
+                return {};
+            }
+
+            return std::move(node.mapped());
+        }
+
+        // Tasks submitted from a worker go to its own deque without locking,
+        // anything else lands in a worker inbox, round robin unless a hint is given.
+        // Under drop_oldest admitted tasks always go through an inbox, the deques
+        // can't give up a task from the middle
+        void enqueue(task_t &&task, priority prio, std::optional<std::size_t> worker_hint, bool admitted) {
+            auto current = current_worker();
+            auto lane = static_cast<std::size_t>(prio);
+            auto evictable = admitted and options.on_overload == overload_policy::drop_oldest;
+
+            if (current and not evictable and (not worker_hint or *worker_hint == *current)) {
+                workers[*current]->local[lane].push(acquire_node(*current, std::move(task)));
+            }
+            else {
+                auto &target = worker_hint
+                    ? *workers[*worker_hint % max_workers]
+                    : current
+                        ? *workers[*current]
+                        : *workers[next_inbox.fetch_add(1, std::memory_order_relaxed) % live.load(std::memory_order_relaxed)];
+
+                std::scoped_lock lock(target.inbox_mtx);
+                target.inbox[lane].push_back({
+                    .task = std::move(task),
+                    .queued_at = std::chrono::steady_clock::now(),
+                    .evictable = evictable
+                });
+                target.inboxed.fetch_add(1, std::memory_order_release);
+            }
+
+            wake_one();
+        }
+
+        bool run_next_task(std::size_t index) {
+            static constexpr std::array<std::array<priority, priority_count>, 3> lane_orders{ {
+                { priority::interactive, priority::normal, priority::background },
+                { priority::normal, priority::interactive, priority::background },
+                { priority::background, priority::interactive, priority::normal },
+            } };
+
+            auto &self = *workers[index];
+            auto pick = ++self.picks;
+
+            const auto &order = (pick % (starvation_interval * 2) == 0)
+                ? lane_orders[2]
+                : (pick % starvation_interval == 0)
+                    ? lane_orders[1]
+                    : lane_orders[0];
+
+            for (auto prio : order) {
+                // One worker is always kept out of the background lane, so there is
+                // someone free to pick up a button press while artwork downloads
+                if (prio == priority::background) {
+                    auto workers_now = live.load(std::memory_order_relaxed);
+                    auto max_background = workers_now <= 1 ? 1 : workers_now - 1;
+
+                    if (running_background.fetch_add(1, std::memory_order_acq_rel) >= max_background) {
+                        running_background.fetch_sub(1, std::memory_order_acq_rel);
+                        continue;
+                    }
+
+                    bool ran = run_from_lane(index, static_cast<std::size_t>(prio));
+                    running_background.fetch_sub(1, std::memory_order_acq_rel);
+
+                    if (ran) {
+                        return true;
+                    }
+                }
+                else if (run_from_lane(index, static_cast<std::size_t>(prio))) {
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        bool run_from_lane(std::size_t index, std::size_t lane) {
+            auto &self = *workers[index];
+
+            auto run_node = [&](task_node *node) {
+                leave_queue();
+                run_timed(self, node->task, node->queued_at);
+                release_node(index, node);
+            };
+
+            auto run_task = [&](queued_task &queued) {
+                leave_queue();
+                run_timed(self, queued.task, queued.queued_at);
+            };
+
+            if (auto node = self.local[lane].pop()) {
+                run_node(*node);
+                return true;
+            }
+
+            if (auto task = pop_inbox(self, lane, false)) {
+                run_task(*task);
+                return true;
+            }
+
+            // Retired slots are scanned too, something may have been left in them
+            for (std::size_t i = 1; i < max_workers; ++i) {
+                auto &victim = *workers[(index + i) % max_workers];
+
+                if (auto node = victim.local[lane].steal()) {
+                    run_node(*node);
+                    return true;
+                }
+
+                if (auto task = pop_inbox(victim, lane, not stop_requested)) {
+                    run_task(*task);
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        static void run_timed(worker &self, task_t &task, std::chrono::steady_clock::time_point queued_at) {
+            auto started = std::chrono::steady_clock::now();
+            self.running_since.store(started.time_since_epoch().count(), std::memory_order_relaxed);
+
+            task();
+
+            auto finished = std::chrono::steady_clock::now();
+            self.running_since.store(0, std::memory_order_relaxed);
+
+            self.arena.release();
+
+            self.queue_wait.record(started - queued_at);
+            self.run_time.record(finished - started);
+
+            impl::atomic_histogram::bump(self.busy_ns, static_cast<uint64_t>((finished - started).count()));
+            impl::atomic_histogram::bump(self.executed, 1);
+        }
+
+        // Thieves only try_lock so they never queue up behind the owner, except
+        // while stopping where every inbox has to be drained
+        static std::optional<queued_task> pop_inbox(worker &target, std::size_t lane, bool try_only) {
+            if (target.inboxed.load(std::memory_order_acquire) == 0) {
+                return std::nullopt;
+            }
+
+            std::unique_lock lock(target.inbox_mtx, std::defer_lock);
+
+            if (try_only) {
+                if (not lock.try_lock()) {
+                    return std::nullopt;
+                }
+            }
+            else {
+                lock.lock();
+            }
+
+            auto queued = target.inbox[lane].pop_front();
+
+            if (queued) {
+                target.inboxed.fetch_sub(1, std::memory_order_relaxed);
+            }
+
+            return queued;
+        }
+
+        void wake_one() {
+            wake_epoch.fetch_add(1, std::memory_order_release);
+            wake_epoch.notify_one();
+        }
+
+        void wake_all() {
+            wake_epoch.fetch_add(1, std::memory_order_release);
+            wake_epoch.notify_all();
+        }
+
+        void scheduler_loop(std::size_t index) {
+            auto &self = *workers[index];
+
+            this_worker = { .owner = this, .index = index, .arena = &self.arena };
+
+            while (true) {
+                auto epoch = wake_epoch.load(std::memory_order_acquire);
+
+                if (run_next_task(index)) {
+                    continue;
+                }
+
+                if (stop_requested or self.retiring) {
+                    break;
+                }
+
+                // Anything submitted after the epoch was read bumps it, so this
+                // returns right away instead of missing the wakeup
+                auto parked = std::chrono::steady_clock::now();
+                self.parked_since.store(parked.time_since_epoch().count(), std::memory_order_relaxed);
+
+                wake_epoch.wait(epoch, std::memory_order_acquire);
+
+                self.parked_since.store(0, std::memory_order_relaxed);
+                impl::atomic_histogram::bump(
+                    self.idle_ns,
+                    static_cast<uint64_t>((std::chrono::steady_clock::now() - parked).count())
+                );
+            }
+
+            this_worker = { .owner = nullptr, .index = 0, .arena = nullptr };
+        }
+
+        // Live workers always are the first slots, the pool grows and shrinks
+        // at the end so round robin over live keeps working
+        void start_worker(std::size_t index) {
+            // A worker that retired from this slot may still be on its way out
+            if (pool[index].joinable()) {
+                pool[index].join();
+            }
+
+            workers[index]->retiring = false;
+            pool[index] = std::thread(std::bind_front(&thread_pool::scheduler_loop, this, index));
+
+            live.fetch_add(1, std::memory_order_acq_rel);
+        }
+
+        void supervise() {
+            auto tick = std::max(
+                std::chrono::milliseconds(10),
+                std::min(options.blocked_threshold, options.idle_timeout) / 2
+            );
+
+            std::unique_lock lock(supervisor_mtx);
+
+            while (not supervisor_cv.wait_for(lock, tick, [&] { return stop_requested.load(); })) {
+                auto now = std::chrono::steady_clock::now().time_since_epoch();
+                auto count = live.load(std::memory_order_acquire);
+
+                if (count < max_workers and every_worker_blocked(count, now)) {
+                    spdlog::debug(fmt::format("Every pool worker is blocked, starting worker {}", count));
+                    start_worker(count);
+                    continue;
+                }
+
+                if (count > min_workers) {
+                    auto &last = *workers[count - 1];
+                    auto since = last.parked_since.load(std::memory_order_relaxed);
+
+                    if (since != 0 and now - std::chrono::steady_clock::duration{ since } >= options.idle_timeout) {
+                        spdlog::debug(fmt::format("Pool worker {} idle, retiring it", count - 1));
+
+                        last.retiring = true;
+                        live.fetch_sub(1, std::memory_order_acq_rel);
+                        wake_all();
+                    }
+                }
+            }
+        }
+
+        // Only worth growing when there is work waiting behind them
+        bool every_worker_blocked(std::size_t count, std::chrono::steady_clock::duration now) const {
+            if (pending.load(std::memory_order_relaxed) == 0) {
+                return false;
+            }
+
+            for (std::size_t i = 0; i < count; ++i) {
+                auto since = workers[i]->running_since.load(std::memory_order_relaxed);
+
+                if (since == 0 or now - std::chrono::steady_clock::duration{ since } < options.blocked_threshold) {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
+        static inline thread_local worker_slot this_worker;
+
+        std::size_t min_workers;
+        std::size_t max_workers;
+        thread_pool_options options;
+
+        std::atomic_size_t live;
+        std::atomic_size_t running_background;
+
+        std::atomic_size_t pending;
+        std::atomic_size_t high_water;
+        std::atomic_uint64_t space_epoch;
+        std::atomic_size_t blocked_submitters;
+
+        std::atomic_uint64_t rejected;
+        std::atomic_uint64_t dropped;
+        std::atomic_uint64_t coalesced;
+
+        std::mutex keyed_mtx;
+        std::unordered_map<std::string, task_t> keyed_tasks;
+
+        std::atomic_size_t next_inbox;
+        std::atomic_uint64_t wake_epoch;
         std::atomic_bool stop_requested;
 
-        std::list<std::thread> pool;
-        std::queue<std::function<void()>> tasks;
+        std::vector<std::thread> pool;
+        std::vector<std::unique_ptr<worker>> workers;
+
+        std::thread supervisor;
+        std::mutex supervisor_mtx;
+        std::condition_variable supervisor_cv;
     };
 
 }    // namespace arti::async
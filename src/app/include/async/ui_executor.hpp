@@ -0,0 +1,150 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <coroutine>
+#include <functional>
+
+#include <async/executor.hpp>
+
+namespace arti::async {
+
+    // Runs jobs on the thread driving the UI loop. Anyone may post, the UI
+    // thread runs them from run_pending(). wake is called whenever the inbox
+    // goes from drained to non empty, e.g. to post an event to the UI loop
+    // so it knows to call run_pending() soon
+    struct ui_executor {
+        explicit ui_executor(std::function<void()> wake_fn)
+            : wake(std::move(wake_fn))
+            , head(&stub)
+            , tail(&stub)
+            , wake_requested(false) {
+            stub.next.store(nullptr, std::memory_order_relaxed);
+        }
+
+        ~ui_executor() {
+            // Whatever was never run is dropped with its nodes
+            while (auto *done = pop()) {
+                delete done;
+            }
+        }
+
+        ui_executor(ui_executor &&) = delete;
+        ui_executor &operator=(ui_executor &&) = delete;
+
+        ui_executor(const ui_executor &) = delete;
+        ui_executor &operator=(const ui_executor &) = delete;
+
+        // Lock free, one exchange on the inbox and at most one wake per drain
+        void post(job_t &&job) {
+            push(new node{ std::move(job) });
+
+            if (not wake_requested.exchange(true, std::memory_order_acq_rel)) {
+                wake();
+            }
+        }
+
+        // UI thread only. Runs everything posted so far, including what those
+        // jobs post themselves, returns how many ran
+        std::size_t run_pending() {
+            // Cleared first, a post racing with the drain wakes the loop again
+            // instead of being left behind until the next one. acq_rel orders
+            // the pushes of producers that skipped the wake before the pops
+            (void) wake_requested.exchange(false, std::memory_order_acq_rel);
+
+            std::size_t ran = 0;
+
+            while (auto *next = pop()) {
+                auto job = std::move(next->job);
+                delete next;
+
+                job();
+                ++ran;
+            }
+
+            return ran;
+        }
+
+        // co_await ui.schedule() continues the coroutine on the UI thread
+        struct schedule_operation {
+            ui_executor *ui;
+
+            bool await_ready() const noexcept {
+                return false;
+            }
+
+            void await_suspend(std::coroutine_handle<> handle) const {
+                ui->post([handle] {
+                    handle.resume();
+                });
+            }
+
+            void await_resume() const noexcept { }
+        };
+
+        schedule_operation schedule() noexcept {
+            return { this };
+        }
+
+      private:
+        struct node {
+            job_t job;
+            std::atomic<node *> next{ nullptr };
+        };
+
+        // Intrusive MPSC queue, producers only ever exchange head, the
+        // consumer owns tail. stub keeps the queue from ever being empty
+        void push(node *item) {
+            item->next.store(nullptr, std::memory_order_relaxed);
+
+            auto *prev = head.exchange(item, std::memory_order_acq_rel);
+            prev->next.store(item, std::memory_order_release);
+        }
+
+        node *pop() {
+            auto *first = tail;
+            auto *next = first->next.load(std::memory_order_acquire);
+
+            if (first == &stub) {
+                if (next == nullptr) {
+                    return nullptr;
+                }
+
+                tail = next;
+                first = next;
+                next = next->next.load(std::memory_order_acquire);
+            }
+
+            if (next != nullptr) {
+                tail = next;
+                return first;
+            }
+
+            // A producer swapped head but hasn't linked its node yet, it's
+            // picked up on the next drain
+            if (first != head.load(std::memory_order_acquire)) {
+                return nullptr;
+            }
+
+            push(&stub);
+            next = first->next.load(std::memory_order_acquire);
+
+            if (next != nullptr) {
+                tail = next;
+                return first;
+            }
+
+            return nullptr;
+        }
+
+        std::function<void()> wake;
+
+        node stub;
+        std::atomic<node *> head;
+        node *tail;
+
+        std::atomic_bool wake_requested;
+    };
+
+}    // namespace arti::async
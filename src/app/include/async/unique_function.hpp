@@ -0,0 +1,143 @@
+#pragma once
+
+#include <new>
+#include <cstddef>
+#include <utility>
+#include <functional>
+#include <type_traits>
+
+namespace arti::async {
+
+    template <typename Signature, std::size_t Capacity = 48>
+    struct unique_function;
+
+    // Move only replacement for std::function, callables up to Capacity bytes
+    // (and nothrow movable) are stored inline, bigger ones go to the heap
+    template <typename R, typename... Args, std::size_t Capacity>
+    struct unique_function<R(Args...), Capacity> {
+        unique_function() noexcept
+            : vtbl(nullptr) { }
+
+        unique_function(std::nullptr_t) noexcept
+            : vtbl(nullptr) { }
+
+        template <typename F>
+        requires(
+            not std::is_same_v<std::remove_cvref_t<F>, unique_function>
+            && std::is_invocable_r_v<R, std::decay_t<F> &, Args...>
+        )
+        unique_function(F &&callable)
+            : vtbl(&vtable_for<std::decay_t<F>>) {
+            using fn_t = std::decay_t<F>;
+
+            if constexpr (stored_inline<fn_t>) {
+                ::new (static_cast<void *>(storage)) fn_t(std::forward<F>(callable));
+            }
+            else {
+                ::new (static_cast<void *>(storage)) fn_t *(new fn_t(std::forward<F>(callable)));
+            }
+        }
+
+        ~unique_function() {
+            reset();
+        }
+
+        unique_function(unique_function &&other) noexcept
+            : vtbl(other.vtbl) {
+            if (vtbl) {
+                vtbl->relocate(storage, other.storage);
+                other.vtbl = nullptr;
+            }
+        }
+
+        unique_function &operator=(unique_function &&other) noexcept {
+            if (this != &other) {
+                reset();
+
+                vtbl = other.vtbl;
+
+                if (vtbl) {
+                    vtbl->relocate(storage, other.storage);
+                    other.vtbl = nullptr;
+                }
+            }
+
+            return *this;
+        }
+
+        unique_function &operator=(std::nullptr_t) noexcept {
+            reset();
+            return *this;
+        }
+
+        unique_function(const unique_function &) = delete;
+        unique_function &operator=(const unique_function &) = delete;
+
+        R operator()(Args... args) {
+            return vtbl->invoke(storage, std::forward<Args>(args)...);
+        }
+
+        explicit operator bool() const noexcept {
+            return vtbl != nullptr;
+        }
+
+        void reset() noexcept {
+            if (vtbl) {
+                vtbl->destroy(storage);
+                vtbl = nullptr;
+            }
+        }
+
+        template <typename F>
+        static constexpr bool stored_inline =
+            sizeof(F) <= Capacity
+            && alignof(F) <= alignof(std::max_align_t)
+            && std::is_nothrow_move_constructible_v<F>;
+
+      private:
+        struct vtable {
+            R (*invoke)(void *, Args &&...);
+            void (*relocate)(void *, void *) noexcept;
+            void (*destroy)(void *) noexcept;
+        };
+
+        template <typename F>
+        static F &access(void *where) {
+            if constexpr (stored_inline<F>) {
+                return *std::launder(static_cast<F *>(where));
+            }
+            else {
+                return **std::launder(static_cast<F **>(where));
+            }
+        }
+
+        template <typename F>
+        static constexpr vtable vtable_for{
+            .invoke = [](void *where, Args &&...args) -> R {
+                return std::invoke(access<F>(where), std::forward<Args>(args)...);
+            },
+            .relocate = [](void *dst, void *src) noexcept {
+                if constexpr (stored_inline<F>) {
+                    F &from = access<F>(src);
+                    ::new (dst) F(std::move(from));
+                    from.~F();
+                }
+                else {
+                    ::new (dst) F *(*std::launder(static_cast<F **>(src)));
+                }
+            },
+            .destroy = [](void *where) noexcept {
+                if constexpr (stored_inline<F>) {
+                    access<F>(where).~F();
+                }
+                else {
+                    delete &access<F>(where);
+                }
+            }
+        };
+
+        alignas(std::max_align_t) std::byte storage[Capacity < sizeof(void *) ? sizeof(void *) : Capacity];
+        const vtable *vtbl;
+    };
+
+}    // namespace arti::async
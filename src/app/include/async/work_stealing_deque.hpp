@@ -0,0 +1,161 @@
+#pragma once
+
+#include <bit>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <optional>
+#include <type_traits>
+
+namespace arti::async {
+
+    // Chase-Lev deque (Lê, Pop, Cohen, Zappa Nardelli, "Correct and Efficient
+    // Work-Stealing for Weak Memory Models"). The owner thread pushes and pops at
+    // the bottom without taking any lock, every other thread steals from the top.
+    template <typename T>
+    requires(std::is_trivially_copyable_v<T>)
+    struct work_stealing_deque {
+        explicit work_stealing_deque(std::size_t capacity = 64)
+            : top(0)
+            , bottom(0) {
+            auto initial = std::make_unique<ring>(std::bit_ceil(capacity));
+            buffer.store(initial.get(), std::memory_order_relaxed);
+            rings.push_back(std::move(initial));
+        }
+
+        ~work_stealing_deque() = default;
+
+        work_stealing_deque(work_stealing_deque &&) = delete;
+        work_stealing_deque &operator=(work_stealing_deque &&) = delete;
+
+        work_stealing_deque(const work_stealing_deque &) = delete;
+        work_stealing_deque &operator=(const work_stealing_deque &) = delete;
+
+        // Owner only
+        void push(T item) {
+            auto b = bottom.load(std::memory_order_relaxed);
+            auto t = top.load(std::memory_order_acquire);
+            auto *r = buffer.load(std::memory_order_relaxed);
+
+            if (b - t > r->capacity - 1) {
+                r = grow(r, t, b);
+            }
+
+            r->put(b, item);
+
+            std::atomic_thread_fence(std::memory_order_release);
+            bottom.store(b + 1, std::memory_order_relaxed);
+        }
+
+        // Owner only
+        std::optional<T> pop() {
+            auto b = bottom.load(std::memory_order_relaxed) - 1;
+            auto *r = buffer.load(std::memory_order_relaxed);
+
+            bottom.store(b, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+
+            auto t = top.load(std::memory_order_relaxed);
+
+            if (t > b) {
+                bottom.store(b + 1, std::memory_order_relaxed);
+                return std::nullopt;
+            }
+
+            T item = r->get(b);
+
+            if (t == b) {
+                // Last element, race against the thieves for it
+                bool won = top.compare_exchange_strong(
+                    t, t + 1,
+                    std::memory_order_seq_cst,
+                    std::memory_order_relaxed
+                );
+
+                bottom.store(b + 1, std::memory_order_relaxed);
+
+                if (not won) {
+                    return std::nullopt;
+                }
+            }
+
+            return item;
+        }
+
+        // Any thread
+        std::optional<T> steal() {
+            auto t = top.load(std::memory_order_acquire);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            auto b = bottom.load(std::memory_order_acquire);
+
+            if (t >= b) {
+                return std::nullopt;
+            }
+
+            auto *r = buffer.load(std::memory_order_acquire);
+            T item = r->get(t);
+
+            if (not top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                return std::nullopt;
+            }
+
+            return item;
+        }
+
+        std::size_t size() const {
+            auto b = bottom.load(std::memory_order_relaxed);
+            auto t = top.load(std::memory_order_relaxed);
+
+            return b > t ? static_cast<std::size_t>(b - t) : 0;
+        }
+
+        bool empty() const {
+            return size() == 0;
+        }
+
+      private:
+        struct ring {
+            explicit ring(int64_t capacity)
+                : capacity(capacity)
+                , mask(capacity - 1)
+                , items(std::make_unique<std::atomic<T>[]>(capacity)) { }
+
+            T get(int64_t index) const {
+                return items[index & mask].load(std::memory_order_relaxed);
+            }
+
+            void put(int64_t index, T item) {
+                items[index & mask].store(item, std::memory_order_relaxed);
+            }
+
+            int64_t capacity;
+            int64_t mask;
+            std::unique_ptr<std::atomic<T>[]> items;
+        };
+
+        ring *grow(ring *old, int64_t t, int64_t b) {
+            auto bigger = std::make_unique<ring>(old->capacity * 2);
+
+            for (auto i = t; i < b; ++i) {
+                bigger->put(i, old->get(i));
+            }
+
+            auto *raw = bigger.get();
+
+            // Thieves may still be reading from the old ring, it is kept alive
+            // until the deque itself goes away
+            rings.push_back(std::move(bigger));
+            buffer.store(raw, std::memory_order_release);
+
+            return raw;
+        }
+
+        alignas(64) std::atomic<int64_t> top;
+        alignas(64) std::atomic<int64_t> bottom;
+        std::atomic<ring *> buffer;
+
+        std::vector<std::unique_ptr<ring>> rings;
+    };
+
+}    // namespace arti::async
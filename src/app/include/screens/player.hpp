@@ -1,7 +1,9 @@
 #pragma once
 
 #include <mutex>
+#include <iterator>
 #include <functional>
+#include <memory_resource>
 
 #include <ftxui/dom/elements.hpp>
 #include <ftxui/screen/screen.hpp>
@@ -12,10 +14,16 @@
 
 #include <spdlog/spdlog.h>
 
+#include <cppcoro/task.hpp>
+#include <cppcoro/sync_wait.hpp>
+
+#include <arti/curl/engine.hpp>
 #include <arti/spotify/client.hpp>
 
+#include <async/strand.hpp>
 #include <async/context.hpp>
 #include <internal/config.hpp>
+#include <async/ui_executor.hpp>
 
 #include <player_state.hpp>
 
@@ -54,8 +62,13 @@ namespace arti::screens {
             horizontal,
         };
 
-        expected<> initialize(async::context *context) {
+        // Everything render() reads is only ever written from jobs posted to
+        // ui_exec, so neither side takes a lock
+        expected<> initialize(async::context *context, async::ui_executor *ui_exec) {
             ctx = context;
+            ui = ui_exec;
+
+            commands.emplace(ctx->io(), async::priority::interactive);
 
             if (auto ok = api.initialize(config::cfg_path); not ok) {
                 return ok;
@@ -67,14 +80,43 @@ namespace arti::screens {
                 return ok;
             }
 
-            update_state();
+            updating = true;
+            refresh_failed = false;
+            cppcoro::sync_wait(update_state());
 
             using namespace std::chrono_literals;
 
-            ctx->schedule(
-                async::schedule_policy::every(750ms),
-                std::bind(&player::update_state, this)
-            );
+            last_interaction = std::chrono::steady_clock::now();
+            polling_idle = false;
+
+            {
+                std::scoped_lock lock(poll_mtx);
+
+                // The slack lets the poll ride along with the UI refresh wakeup.
+                // While the API can't be reached it backs off up to 30s, the
+                // outcome reported is the one of the previous refresh
+                poll_timer = ctx->schedule(
+                    async::schedule_policy::exponential_backoff(active_poll_period, 30s, 250ms),
+                    [this] {
+                        // Nobody touched the controls in a while, poll less often
+                        auto idle = std::chrono::steady_clock::now() - last_interaction.load() > idle_after;
+
+                        if (idle and not polling_idle.exchange(true)) {
+                            std::scoped_lock lock(poll_mtx);
+                            poll_timer.set_period(idle_poll_period);
+                        }
+
+                        // Previous refresh still waiting on the API, skip this tick
+                        if (not updating.exchange(true)) {
+                            ctx->spawn(update_state());
+                        }
+
+                        return refresh_failed
+                            ? async::schedule_policy::run_result::failure
+                            : async::schedule_policy::run_result::success;
+                    }
+                );
+            }
 
             auto custom_button = ftxui::ButtonOption{};            
 
@@ -96,30 +138,8 @@ namespace arti::screens {
                 ftxui::Button(
                     &heart_icon,
                     [&] {
-                        std::scoped_lock lock(state_mtx);
-                        ctx->run_and_ignore(
-                            [](std::optional<std::string> type, bool saved, std::string id, std::atomic_bool &update_saved) {
-                                if (not type) {
-                                    return spdlog::error("Called like in null item");
-                                }
-
-                                auto api = spotify::client{};
-
-                                if (saved) {
-                                    auto ok = api.del(fmt::format("/me/{}?ids={}", *type, id));
-
-                                    if (ok and ok->code == 200) {
-                                        update_saved = true;
-                                    }
-                                }
-                                else {
-                                    auto ok = api.put(fmt::format("/me/{}?ids={}", *type, id), nlohmann::json::object_t{});
-
-                                    if (ok and ok->code == 200) {
-                                        update_saved = true;
-                                    }
-                                }
-                            },
+                        interacted();
+                        ctx->spawn(toggle_saved(
                             state->item.has_value()
                             ? std::optional<std::string>(
                                 state->is_track()
@@ -128,9 +148,8 @@ namespace arti::screens {
                             )
                             : std::nullopt,
                             saved_current,
-                            std::string{ state->get_id() },
-                            std::ref(update_saved)
-                        );
+                            std::string{ state->get_id() }
+                        ));
                     },
                     custom_button
                 ),
@@ -148,19 +167,20 @@ namespace arti::screens {
                 ftxui::Button(
                     &rewind_icon,
                     [&] {
-                        ctx->run_and_ignore([](std::mutex &mtx, std::shared_ptr<player_state> &stt,int32_t ms) {
+                        interacted();
+
+                        // A seek still waiting behind another command is replaced
+                        commands->post(async::coalesce_key{ "player.seek" }, [this, ms = std::min<int32_t>(state->progress_ms - 2500, state->get_duration_ms())] {
                             auto api = spotify::client{};
 
-                            if (auto ok = api.put(fmt::format("/me/player/seek?position_ms={}", ms), ""); not ok) {
+                            if (auto ok = api.put(endpoint("/me/player/seek?position_ms={}", ms), ""); not ok) {
                                 spdlog::error("Coudlnt PUT to next");
                             }
 
-                            std::scoped_lock lock(mtx);
-                            stt->progress_ms -= 3500;
-                        }, std::ref(state_mtx), std::ref(state), [&] {
-                            std::scoped_lock lock(state_mtx);
-                            return std::min<int32_t>(state->progress_ms - 2500, state->get_duration_ms());
-                        }());
+                            ui->post([this] {
+                                state->progress_ms -= 3500;
+                            });
+                        });
                     },
                     custom_button
                 ),
@@ -169,13 +189,8 @@ namespace arti::screens {
                 ftxui::Button(
                     &previous_icon,
                     [&] {
-                        ctx->run_and_ignore([] {
-                            auto api = spotify::client{};
-
-                            if (auto ok = api.post("/me/player/previous", ""); not ok) {
-                                spdlog::error("Coudlnt PUT to next");
-                            }
-                        });
+                        interacted();
+                        ctx->spawn(skip_to("/me/player/previous"));
                     },
                     custom_button
                 ),
@@ -184,43 +199,11 @@ namespace arti::screens {
                 ftxui::Button(
                     &play_icon,
                     [&] {
-                        std::scoped_lock lock(state_mtx);
-                        ctx->run_and_ignore([] (bool active, std::optional<std::string> id) {
-                            auto api = spotify::client{};
-
-                            if (active) {
-                                auto response = api.put(fmt::format(
-                                    "/me/player/pause{}",
-                                    id
-                                    ? fmt::format("?device_id={}", *id)
-                                    : ""
-                                ), "");
-
-                                if (not response) {
-                                    return spdlog::error("ERROR 1");
-                                }
-
-                                if (not (response->code == 200 or response->code == 204)) {
-                                    return spdlog::error(fmt::format("ERROR 2, {}", response->body.dump(2)));
-                                }
-                            }
-                            else {
-                                auto response = api.put(fmt::format(
-                                    "/me/player/play{}",
-                                    id
-                                    ? fmt::format("?device_id={}", *id)
-                                    : ""
-                                ), nlohmann::json::object_t{});
-
-                                if (not response) {
-                                    return spdlog::error("ERROR 3");
-                                }
-
-                                if (not (response->code == 200 or response->code == 204)) {
-                                    return spdlog::error(fmt::format("ERROR 4, {}\n{}", *id, response->body.dump(2)));
-                                }
-                            }
-                        }, state->is_active, state->device ? std::optional{ state->device->id } : std::nullopt);
+                        interacted();
+                        ctx->spawn(toggle_playback(
+                            state->is_active,
+                            state->device ? std::optional{ state->device->id } : std::nullopt
+                        ));
                     },
                     custom_button
                 ),
@@ -229,13 +212,8 @@ namespace arti::screens {
                 ftxui::Button(
                     &next_icon,
                     [&] {
-                        ctx->run_and_ignore([] {
-                            auto api = spotify::client{};
-
-                            if (auto ok = api.post("/me/player/next", ""); not ok) {
-                                spdlog::error("POST to spotify api failed, endpoint: '/me/player/next'", ok.error());
-                            }
-                        });
+                        interacted();
+                        ctx->spawn(skip_to("/me/player/next"));
                     },
                     custom_button
                 ),
@@ -244,19 +222,20 @@ namespace arti::screens {
                 ftxui::Button(
                     &forward_icon,
                     [&] {
-                        ctx->run_and_ignore([](std::mutex &mtx, std::shared_ptr<player_state> &stt,int32_t ms) {
+                        interacted();
+
+                        // A seek still waiting behind another command is replaced
+                        commands->post(async::coalesce_key{ "player.seek" }, [this, ms = std::min<int32_t>(state->progress_ms + 2500, state->get_duration_ms())] {
                             auto api = spotify::client{};
 
-                            if (auto ok = api.put(fmt::format("/me/player/seek?position_ms={}", ms), ""); not ok) {
+                            if (auto ok = api.put(endpoint("/me/player/seek?position_ms={}", ms), ""); not ok) {
                                 spdlog::error("Coudlnt PUT to next");
                             }
 
-                            std::scoped_lock lock(mtx);
-                            stt->progress_ms += 3500;
-                        }, std::ref(state_mtx), std::ref(state), [&] {
-                            std::scoped_lock lock(state_mtx);
-                            return std::min<int32_t>(state->progress_ms + 2500, state->get_duration_ms());
-                        }());
+                            ui->post([this] {
+                                state->progress_ms += 3500;
+                            });
+                        });
                     },
                     custom_button
                 ),
@@ -265,29 +244,11 @@ namespace arti::screens {
                 ftxui::Button(
                     &shuffle_icon,
                     [&] {
-                        std::scoped_lock lock(state_mtx);
-                        ctx->run_and_ignore(
-                            [](spotify_state::shuffle shffl, std::optional<std::string> id) {
-                                auto api = spotify::client{};
-
-                                auto ok = api.put(
-                                    fmt::format(
-                                        "/me/player/shuffle?state={}{}",
-                                        shffl != spotify_state::shuffle::on,
-                                        id
-                                        ? fmt::format("&device_id={}", *id)
-                                        : ""
-                                    ),
-                                    nlohmann::json::object_t{}
-                                );
-
-                                if (not ok or (ok and not (ok->code == 204 or ok->code == 200))) {
-                                    spdlog::error("Failed to update shuffle state");
-                                }
-                            },
+                        interacted();
+                        ctx->spawn(toggle_shuffle(
                             state->shuffle,
                             state->device ? std::optional{ state->device->id } : std::nullopt
-                        );
+                        ));
                     },
                     custom_button
                 )
@@ -296,25 +257,44 @@ namespace arti::screens {
             return {};
         }
 
-        void update_state() {
-            auto id = [&] -> std::string {
-                std::scoped_lock lock(state_mtx);
-                return std::string{ state->get_id() };
-            }();
+        // Refreshes the playback state, artwork is fetched by its own coroutine
+        // so the state isn't held back by it. Requests go through the HTTP
+        // engine, past the first one this runs on its event thread, which is
+        // fine for parsing a small response and posting it to the UI
+        cppcoro::task<> update_state() {
+            struct clear_on_exit {
+                std::atomic_bool &flag;
+
+                ~clear_on_exit() {
+                    flag = false;
+                }
+            } guard{ updating };
 
-            auto response = api.get("/me/player?additional_types=track,episode");
+            auto response = co_await api.async_get("/me/player?additional_types=track,episode");
 
+            // Only the first failure of an outage is an error, the rest would
+            // repeat it every retry
             if (not response) {
-                spdlog::error(fmt::format("Failed to update player state: {}", response.error()));
-                return;
+                if (not refresh_failed.exchange(true)) {
+                    spdlog::error(fmt::format("Failed to update player state: {}", response.error()));
+                }
+                else {
+                    spdlog::debug(fmt::format("Failed to update player state: {}", response.error()));
+                }
+
+                co_return;
+            }
+
+            if (refresh_failed.exchange(false)) {
+                spdlog::info("Player state reachable again");
             }
 
             auto new_state = std::make_shared<player_state>();
             new_state->update(response.value());
 
-            auto new_id = new_state->get_id();
+            auto new_id = std::string{ new_state->get_id() };
 
-            if (not new_id.empty() and new_id != id) {
+            if (not new_id.empty() and new_id != fetched_id) {
                 update_saved = true;
 
                 auto images = [&]() -> std::vector<arti::spotify_state::image> * {
@@ -328,102 +308,230 @@ namespace arti::screens {
                     return nullptr;
                 }();
 
+                // Runs here only until the request is submitted
                 if (images != nullptr and not images->empty()) {
-                    auto image_url = images->front().url;
-
-                    ctx->run_and_ignore(
-                    [image_url = std::move(image_url)] (decltype(img) &img_) {
-                        auto image_data = arti::curl::request::get(image_url);
-
-                        if (not image_data) {
-                            return spdlog::error(
-                                fmt::format(
-                                    "Failed image curl request, code: {}, message: {}",
-                                    image_data.error().code,
-                                    image_data.error().message
-                                )
-                            );
-                        }
+                    ctx->spawn(fetch_artwork(images->front().url));
+                }
+            }
 
-                        if (image_data->code != 200) {
-                            return spdlog::error(
-                                fmt::format(
-                                    "Image curl request responded with code: {}",
-                                    image_data->code
-                                )
-                            );
-                        }
+            fetched_id = new_id;
 
-                        image new_image;
+            std::optional<bool> saved;
 
-                        auto ok = new_image.construct(std::move(image_data->body), img_.dimx, img_.dimy);
+            if (update_saved) {
+                if (new_state->is_track()) {
+                    saved = co_await fetch_saved("tracks", new_id);
+                }
+                else if (new_state->is_episode()) {
+                    saved = co_await fetch_saved("episodes", new_id);
+                }
+                else {
+                    saved = false;
+                }
 
-                        if (not ok) {
-                            return spdlog::error(
-                                fmt::format(
-                                    "Failed to construct image, '{}'",
-                                    ok.error()
-                                )
-                            );
-                        }
+                update_saved = false;
+            }
 
-                        {
-                            std::scoped_lock lock(img_.img_mtx);
-                            img_.img.swap(new_image);
-                        }
-                    }, std::ref(img));
+            auto new_shuffle = new_state->shuffle == spotify_state::shuffle::on;
+            // auto new_repeat = 0;
+
+            // Published on the UI thread, render() never waits on a refresh
+            ui->post([this, new_state = std::move(new_state), saved, new_shuffle]() mutable {
+                state.swap(new_state);
+
+                if (saved) {
+                    saved_current = *saved;
                 }
+
+                shuffle_icon = shuffle_icons[new_shuffle];
+                heart_icon = heart_icons[saved_current];
+                play_icon = play_icons[state->is_active ? 0 : 1];
+            });
+        }
+
+        cppcoro::task<bool> fetch_saved(std::string type, std::string id) {
+            auto path = fmt::format("/me/{}/contains?ids={}", type, id);
+            auto saved_response = co_await api.async_get(std::move(path));
+
+            if (not saved_response.has_value()) {
+                spdlog::error(fmt::format("Failed to fetch saved state of {}, '{}'", type, saved_response.error()));
+                co_return false;
             }
 
-            if (update_saved) {
-                auto saved = [&] {
-                    if (new_state->is_track()) {
-                        auto saved_response = api.get(fmt::format("/me/tracks/contains?ids={}", new_id));
+            if (saved_response->code != 200) {
+                spdlog::error(fmt::format("Failed to fetch saved state of {}, code {}: body: '{}'", type, saved_response->code, saved_response->body.dump()));
+                co_return false;
+            }
 
-                        if (not saved_response.has_value()) {
-                            spdlog::error(fmt::format("Failed to fetch saved state of track, '{}'", saved_response.error()));
-                            return false;
-                        }
+            co_return saved_response->body[0].get<bool>();
+        }
 
-                        if (saved_response->code != 200) {
-                            spdlog::error(fmt::format("Failed to fetch saved state of track, code {}: body: '{}'", saved_response->code, saved_response->body.dump()));
-                            return false;
-                        }
+        cppcoro::task<> fetch_artwork(std::string image_url) {
+            arti::curl::http_request request{ .url = std::move(image_url) };
+            auto image_data = co_await arti::curl::engine::global().send(std::move(request));
 
-                        return saved_response->body[0].get<bool>();
-                    }
-                    else if (new_state->is_episode()) {
-                        auto saved_response = api.get(fmt::format("/me/episodes/contains?ids={}", new_id));
+            if (not image_data) {
+                spdlog::error(
+                    fmt::format(
+                        "Failed image curl request, code: {}, message: {}",
+                        image_data.error().code,
+                        image_data.error().message
+                    )
+                );
+                co_return;
+            }
 
-                        if (not saved_response.has_value()) {
-                            spdlog::error(fmt::format("Failed to fetch saved state of episode, '{}'", saved_response.error()));
-                            return false;
-                        }
+            if (image_data->code != 200) {
+                spdlog::error(
+                    fmt::format(
+                        "Image curl request responded with code: {}",
+                        image_data->code
+                    )
+                );
+                co_return;
+            }
 
-                        if (saved_response->code != 200) {
-                            spdlog::error(fmt::format("Failed to fetch saved state of episode, code {}: body: '{}'", saved_response->code, saved_response->body.dump()));
-                            return false;
-                        }
+            // Decoding and scaling only needs cores, get off the event thread
+            co_await ctx->on_compute(async::priority::background);
 
-                        return saved_response->body[0].get<bool>();
-                    }
+            image new_image;
 
-                    return false;
-                }();
-                saved_current = saved;
-                update_saved = false;
+            auto ok = new_image.construct(std::move(image_data->body), img.dimx, img.dimy);
+
+            if (not ok) {
+                spdlog::error(
+                    fmt::format(
+                        "Failed to construct image, '{}'",
+                        ok.error()
+                    )
+                );
+                co_return;
             }
 
+            ui->post([this, new_image = std::move(new_image)]() mutable {
+                img.img.swap(new_image);
+            });
+        }
 
-            auto new_shuffle = new_state->shuffle == spotify_state::shuffle::on;
-            // auto new_repeat = 0;
+        // Called by every button, brings the poll back to its fast period
+        void interacted() {
+            last_interaction = std::chrono::steady_clock::now();
 
-            std::scoped_lock lock(state_mtx);
-            state.swap(new_state);
+            if (polling_idle.exchange(false)) {
+                std::scoped_lock lock(poll_mtx);
+                poll_timer.set_period(active_poll_period);
+            }
+        }
+
+        // Button handlers, started from the UI thread they hop onto the commands
+        // strand before touching the network, so clicks reach the API in the
+        // order they were made. They must not suspend again once on it
+
+        cppcoro::task<> toggle_saved(std::optional<std::string> type, bool saved, std::string id) {
+            co_await commands->schedule();
+
+            if (not type) {
+                spdlog::error("Called like in null item");
+                co_return;
+            }
+
+            auto api = spotify::client{};
+
+            if (saved) {
+                auto ok = api.del(endpoint("/me/{}?ids={}", *type, id));
+
+                if (ok and ok->code == 200) {
+                    update_saved = true;
+                }
+            }
+            else {
+                auto ok = api.put(endpoint("/me/{}?ids={}", *type, id), nlohmann::json::object_t{});
 
-            shuffle_icon = shuffle_icons[new_shuffle];
-            heart_icon = heart_icons[saved_current];
-            play_icon = play_icons[state->is_active ? 0 : 1];
+                if (ok and ok->code == 200) {
+                    update_saved = true;
+                }
+            }
+        }
+
+        cppcoro::task<> skip_to(std::string path) {
+            co_await commands->schedule();
+
+            auto api = spotify::client{};
+
+            if (auto ok = api.post(path, ""); not ok) {
+                spdlog::error(fmt::format("POST to spotify api failed, endpoint: '{}', '{}'", path, ok.error()));
+            }
+        }
+
+        cppcoro::task<> toggle_playback(bool active, std::optional<std::string> id) {
+            co_await commands->schedule();
+
+            auto api = spotify::client{};
+
+            if (active) {
+                auto response = api.put(endpoint(
+                    "/me/player/pause{}",
+                    id
+                    ? fmt::format("?device_id={}", *id)
+                    : ""
+                ), "");
+
+                if (not response) {
+                    spdlog::error("ERROR 1");
+                    co_return;
+                }
+
+                if (not (response->code == 200 or response->code == 204)) {
+                    spdlog::error(fmt::format("ERROR 2, {}", response->body.dump(2)));
+                }
+            }
+            else {
+                auto response = api.put(endpoint(
+                    "/me/player/play{}",
+                    id
+                    ? fmt::format("?device_id={}", *id)
+                    : ""
+                ), nlohmann::json::object_t{});
+
+                if (not response) {
+                    spdlog::error("ERROR 3");
+                    co_return;
+                }
+
+                if (not (response->code == 200 or response->code == 204)) {
+                    spdlog::error(fmt::format("ERROR 4, {}\n{}", id.value_or(""), response->body.dump(2)));
+                }
+            }
+        }
+
+        cppcoro::task<> toggle_shuffle(spotify_state::shuffle shffl, std::optional<std::string> id) {
+            co_await commands->schedule();
+
+            auto api = spotify::client{};
+
+            auto ok = api.put(
+                endpoint(
+                    "/me/player/shuffle?state={}{}",
+                    shffl != spotify_state::shuffle::on,
+                    id
+                    ? fmt::format("&device_id={}", *id)
+                    : ""
+                ),
+                nlohmann::json::object_t{}
+            );
+
+            if (not ok or (ok and not (ok->code == 204 or ok->code == 200))) {
+                spdlog::error("Failed to update shuffle state");
+            }
+        }
+
+        // Request paths only live for the call, so they come from the running
+        // worker's arena instead of the global heap
+        template <typename... Args>
+        static std::pmr::string endpoint(fmt::format_string<Args...> path, Args &&...args) {
+            std::pmr::string formatted{ async::thread_pool::task_arena() };
+            fmt::format_to(std::back_inserter(formatted), path, std::forward<Args>(args)...);
+            return formatted;
         }
 
         ftxui::Element render() {
@@ -520,8 +628,6 @@ namespace arti::screens {
                 | flex_grow;
             }
 
-            std::scoped_lock lock(img.img_mtx);
-            
             return vbox(
                 vbox(
                     vbox(
@@ -568,8 +674,8 @@ namespace arti::screens {
             );
         }
 
+        // UI thread only
         std::shared_ptr<player_state> get_state() {
-            std::scoped_lock lock(state_mtx);
             return state;
         }
 
@@ -617,21 +723,44 @@ namespace arti::screens {
         ftxui::Dimensions ts;
 
         async::context *ctx;
-        
-        std::mutex state_mtx;
+        async::ui_executor *ui;
+
+        // Player commands, in click order, on the interactive lane
+        std::optional<async::strand> commands;
+
+        // Owned by the UI thread
         std::shared_ptr<player_state> state;
 
+        // Id of the last fetched item, only touched by update_state
+        std::string fetched_id;
+
         spotify::client api;
 
         ftxui::Component controls;
 
+        // Owned by the UI thread
         bool saved_current;
         std::atomic_bool update_saved;
+
+        // Set while an update_state run is in flight
+        std::atomic_bool updating;
+
+        // Whether the last update_state run couldn't reach the API
+        std::atomic_bool refresh_failed;
+
+        static constexpr std::chrono::milliseconds active_poll_period{ 750 };
+        static constexpr std::chrono::milliseconds idle_poll_period{ 3000 };
+        static constexpr std::chrono::seconds idle_after{ 30 };
+
+        // Guarded by poll_mtx
+        std::mutex poll_mtx;
+        async::context::scheduled_task_handle poll_timer;
+        std::atomic_bool polling_idle;
+        std::atomic<std::chrono::steady_clock::time_point> last_interaction;
         struct {
             int dimx;
             int dimy;
             image img;
-            std::mutex img_mtx;
         } img;
     };
 
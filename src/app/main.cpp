@@ -15,12 +15,19 @@
 #include <ftxui/screen/color_info.hpp>
 #include <ftxui/screen/terminal.hpp>
 
+#include <fmt/chrono.h>
+
 #include <spdlog/spdlog.h>
 #include <spdlog/sinks/daily_file_sink.h>
 
+#include <arti/curl/share.hpp>
+#include <arti/curl/engine.hpp>
+#include <arti/curl/body_pool.hpp>
 #include <arti/spotify/client.hpp>
+#include <arti/curl/connection_pool.hpp>
 
 #include <async/context.hpp>
+#include <async/ui_executor.hpp>
 
 #include <player_state.hpp>
 
@@ -37,18 +44,37 @@ int main() {
     daily_logger->set_level(spdlog::level::trace);
     spdlog::set_default_logger(daily_logger);
 
-    async::context ctx{ 6 };
+    // Under a stalled network stale work is dropped instead of replayed minutes later.
+    // Two I/O workers while idle, more only while requests keep all of them blocked.
+    // Decoding gets its own pool with one worker per core
+    async::context ctx{
+        3,
+        {
+            .capacity = 64,
+            .on_overload = async::overload_policy::drop_oldest,
+            .max_threads = 12
+        }
+    };
 
     ctx.initialize();
 
+    auto screen = ftxui::ScreenInteractive::Fullscreen();
+
+    // Background work hands its results to the UI thread through here, the
+    // custom event makes the loop drain it
+    async::ui_executor ui{ [&screen] {
+        screen.PostEvent(ftxui::Event::Custom);
+    } };
+
     arti::screens::player player_screen;
 
-    if (auto ok = player_screen.initialize(&ctx); not ok) {
+    if (auto ok = player_screen.initialize(&ctx, &ui); not ok) {
         spdlog::error(fmt::format("Failed to initialize player screen: '{}'", ok.error()));
         return -1;
     }
 
-    auto screen = ftxui::ScreenInteractive::Fullscreen();
+    // The first refresh, before anything is rendered
+    ui.run_pending();
 
     int tab_index = 0;
 
@@ -110,6 +136,11 @@ int main() {
     auto with_input = ftxui::CatchEvent(
         main_renderer,
         [&](ftxui::Event event) -> bool {
+            if (event == ftxui::Event::Custom) {
+                ui.run_pending();
+                return false;
+            }
+
             if (event.is_character()) {
                 switch (event.character()[0]) {
                     case 'q':
@@ -123,15 +154,118 @@ int main() {
     );
 
     ctx.schedule(
-        async::schedule_policy::every(std::chrono::milliseconds(250)),
+        async::schedule_policy::every(std::chrono::milliseconds(250), std::chrono::milliseconds(50)),
         [&] {
             screen.PostEvent(ftxui::Event::Custom);
             return refresh_ui_continue.load();
         }
     );
 
+    // Tells pool saturation (queue wait) apart from slow requests (run time)
+    ctx.schedule(
+        async::schedule_policy::every(std::chrono::seconds(30), std::chrono::seconds(5)),
+        [&] {
+            auto stats = ctx.snapshot();
+
+            spdlog::debug(fmt::format(
+                "I/O pool: {} workers, depth {} (peak {}), wait p50 {} p99 {}, run p50 {} p99 {}, dropped {}",
+                stats.io.live_workers,
+                stats.io.queue.depth,
+                stats.io.queue.high_water,
+                stats.io.queue_wait.percentile(0.5),
+                stats.io.queue_wait.percentile(0.99),
+                stats.io.run_time.percentile(0.5),
+                stats.io.run_time.percentile(0.99),
+                stats.io.queue.dropped
+            ));
+
+            spdlog::debug(fmt::format(
+                "Compute pool: depth {}, wait p99 {}, run p99 {}",
+                stats.compute.queue.depth,
+                stats.compute.queue_wait.percentile(0.99),
+                stats.compute.run_time.percentile(0.99)
+            ));
+
+            spdlog::debug(fmt::format(
+                "Timers: {} wakeups, jitter p50 {} p99 {} max {}",
+                stats.timer_wakeups,
+                stats.timer_jitter.percentile(0.5),
+                stats.timer_jitter.percentile(0.99),
+                std::chrono::duration_cast<std::chrono::microseconds>(stats.timer_jitter.max)
+            ));
+
+            auto http = arti::curl::connection_pool::global().stats();
+
+            spdlog::debug(fmt::format(
+                "HTTP pool: {} reused, {} created, {} evicted, {} waits, {} idle, {} in use",
+                http.reused,
+                http.created,
+                http.evicted,
+                http.waited,
+                http.idle,
+                http.in_use
+            ));
+
+            auto engine = arti::curl::engine::global().stats();
+
+            spdlog::debug(fmt::format(
+                "HTTP engine: {} done, {} failed, {} over HTTP/2, {} over HTTP/1.x, {} connections, {} in flight (peak {})",
+                engine.completed,
+                engine.failed,
+                engine.http2_responses,
+                engine.http1_responses,
+                engine.connections,
+                engine.in_flight,
+                engine.peak_in_flight
+            ));
+
+            auto tls = arti::curl::share::global().stats();
+
+            spdlog::debug(fmt::format(
+                "TLS: {} resumed, {} full, {} unknown handshakes, {} plain connections",
+                tls.resumed_handshakes,
+                tls.full_handshakes,
+                tls.unknown_handshakes,
+                tls.plain_connections
+            ));
+
+            auto bodies = arti::curl::body_pool::global().stats();
+
+            spdlog::debug(fmt::format(
+                "Response buffers: {} reused, {} allocated, {} recycled, {} dropped, {} KiB pooled",
+                bodies.hits,
+                bodies.misses,
+                bodies.recycled,
+                bodies.dropped,
+                bodies.pooled_bytes / 1024
+            ));
+
+            for (const auto &task : stats.scheduled) {
+                if (task.overruns > 0 or task.skipped > 0) {
+                    spdlog::debug(fmt::format(
+                        "Scheduled task {}: {} runs, {} overruns, {} skipped, longest {}, late p99 {}, callback p99 {}",
+                        task.id.value,
+                        task.runs,
+                        task.overruns,
+                        task.skipped,
+                        std::chrono::duration_cast<std::chrono::milliseconds>(task.longest_run),
+                        task.lateness.percentile(0.99),
+                        task.callback_time.percentile(0.99)
+                    ));
+                }
+            }
+
+            return refresh_ui_continue.load();
+        }
+    );
+
     screen.Loop(with_input);
     refresh_ui_continue = false;
 
+    // Requests still in flight fail now, while what they resume is alive.
+    // Nothing may post to ui once it's gone
+    arti::curl::engine::global().stop();
+    ctx.join();
+
     return 0;
 }
@@ -0,0 +1,463 @@
+#include <new>
+#include <array>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdlib>
+#include <algorithm>
+#include <memory_resource>
+
+#include <benchmark/benchmark.h>
+
+#include <spdlog/spdlog.h>
+
+#include <async/future.hpp>
+#include <async/strand.hpp>
+#include <async/context.hpp>
+#include <async/thread_pool.hpp>
+#include <async/manual_clock.hpp>
+
+namespace async = arti::async;
+
+// Every heap allocation in the process goes through here, benchmarks report
+// the ones made between two reads as allocations per task
+static std::atomic_uint64_t allocations{ 0 };
+
+void *operator new(std::size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+
+    if (auto *ptr = std::malloc(size == 0 ? 1 : size)) {
+        return ptr;
+    }
+
+    throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+namespace {
+
+    using bench_clock = std::chrono::steady_clock;
+
+    // Shared by every thread of a multi producer benchmark, the workers
+    // outlive all of them
+    async::thread_pool &shared_pool() {
+        static async::thread_pool pool(std::max(2u, std::thread::hardware_concurrency()));
+
+        static std::once_flag started;
+        std::call_once(started, [] {
+            pool.initialize();
+        });
+
+        return pool;
+    }
+
+    void wait_for(const std::atomic_uint64_t &counter, uint64_t expected) {
+        while (counter.load(std::memory_order_acquire) < expected) {
+            std::this_thread::yield();
+        }
+    }
+
+    // Submissions per second with 1 to N threads submitting at once
+    void run_and_ignore_throughput(benchmark::State &state) {
+        auto &pool = shared_pool();
+        std::atomic_uint64_t done{ 0 };
+        uint64_t submitted = 0;
+
+        for (auto _ : state) {
+            if (pool.run_and_ignore([&done] { done.fetch_add(1, std::memory_order_release); })) {
+                ++submitted;
+            }
+        }
+
+        wait_for(done, submitted);
+        state.SetItemsProcessed(static_cast<int64_t>(submitted));
+    }
+
+    BENCHMARK(run_and_ignore_throughput)->ThreadRange(1, 8)->UseRealTime();
+
+    void run_async_throughput(benchmark::State &state) {
+        auto &pool = shared_pool();
+        std::vector<async::future<int>> pending;
+        pending.reserve(256);
+
+        for (auto _ : state) {
+            if (auto submitted = pool.run_async([] { return 1; })) {
+                pending.push_back(std::move(*submitted));
+            }
+
+            if (pending.size() == 256) {
+                for (auto &result : pending) {
+                    benchmark::DoNotOptimize(result.get());
+                }
+
+                pending.clear();
+            }
+        }
+
+        for (auto &result : pending) {
+            benchmark::DoNotOptimize(result.get());
+        }
+
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    BENCHMARK(run_async_throughput)->ThreadRange(1, 8)->UseRealTime();
+
+    // From run_and_ignore returning to the task starting on a worker, one at
+    // a time so nothing queues ahead of it
+    void submit_to_run_latency(benchmark::State &state) {
+        auto &pool = shared_pool();
+
+        for (auto _ : state) {
+            std::atomic<bench_clock::rep> started{ 0 };
+
+            auto submitted_at = bench_clock::now();
+
+            (void) pool.run_and_ignore([&started] {
+                started.store(bench_clock::now().time_since_epoch().count(), std::memory_order_release);
+            });
+
+            while (started.load(std::memory_order_acquire) == 0) {
+                std::this_thread::yield();
+            }
+
+            auto start = bench_clock::time_point{ bench_clock::duration{ started.load() } };
+            state.SetIterationTime(std::chrono::duration<double>(start - submitted_at).count());
+        }
+    }
+
+    BENCHMARK(submit_to_run_latency)->UseManualTime();
+
+    // Click to dispatch for an interactive task while every worker has
+    // background and normal work queued
+    void interactive_latency_under_load(benchmark::State &state) {
+        async::thread_pool pool(3);
+        pool.initialize();
+
+        std::atomic_bool loaded{ true };
+
+        auto keep_busy = [&loaded] {
+            if (loaded.load(std::memory_order_relaxed)) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            }
+        };
+
+        for (auto _ : state) {
+            state.PauseTiming();
+
+            for (int i = 0; i < 50; ++i) {
+                (void) pool.run_and_ignore(async::priority::background, keep_busy);
+                (void) pool.run_and_ignore(async::priority::normal, keep_busy);
+            }
+
+            state.ResumeTiming();
+
+            std::atomic<bench_clock::rep> started{ 0 };
+            auto submitted_at = bench_clock::now();
+
+            (void) pool.run_and_ignore(async::priority::interactive, [&started] {
+                started.store(bench_clock::now().time_since_epoch().count(), std::memory_order_release);
+            });
+
+            while (started.load(std::memory_order_acquire) == 0) {
+                std::this_thread::yield();
+            }
+
+            auto start = bench_clock::time_point{ bench_clock::duration{ started.load() } };
+            state.SetIterationTime(std::chrono::duration<double>(start - submitted_at).count());
+
+            // Drain the load so every iteration starts from the same queue
+            state.PauseTiming();
+            loaded = false;
+
+            while (pool.queue_statistics().depth > 0) {
+                std::this_thread::yield();
+            }
+
+            loaded = true;
+            state.ResumeTiming();
+        }
+
+        pool.join();
+    }
+
+    BENCHMARK(interactive_latency_under_load)->UseManualTime()->Iterations(200);
+
+    // Player command strand on a full drop_oldest pool flooded with tasks. A
+    // strand drain is an internal job and must never be the one evicted, or
+    // the strand stops running anything posted to it
+    void strand_under_drop_oldest(benchmark::State &state) {
+        async::thread_pool pool(1, { .capacity = 1, .on_overload = async::overload_policy::drop_oldest });
+        pool.initialize();
+
+        async::strand commands(pool, async::priority::interactive);
+
+        std::atomic_uint64_t ran{ 0 };
+        uint64_t posted = 0;
+
+        for (auto _ : state) {
+            // The only worker is held, so the drain and the flood stay queued
+            std::atomic_bool started{ false };
+            std::atomic_bool release{ false };
+
+            (void) pool.run_and_ignore([&] {
+                started = true;
+                started.notify_one();
+                release.wait(false);
+            });
+
+            started.wait(false);
+
+            for (int i = 0; i < 4; ++i) {
+                commands.post([&ran] {
+                    ran.fetch_add(1, std::memory_order_release);
+                });
+            }
+
+            posted += 4;
+
+            for (int i = 0; i < 16; ++i) {
+                (void) pool.run_and_ignore([] { });
+            }
+
+            release = true;
+            release.notify_one();
+
+            auto deadline = bench_clock::now() + std::chrono::seconds(1);
+
+            while (ran.load(std::memory_order_acquire) < posted and bench_clock::now() < deadline) {
+                std::this_thread::yield();
+            }
+
+            if (ran.load(std::memory_order_acquire) < posted) {
+                state.SkipWithError("Strand stopped running after its drain was dropped");
+                break;
+            }
+        }
+
+        auto stats = pool.queue_statistics();
+
+        state.counters["dropped"] = benchmark::Counter(static_cast<double>(stats.dropped));
+        state.counters["rejected"] = benchmark::Counter(static_cast<double>(stats.rejected));
+
+        pool.join();
+    }
+
+    BENCHMARK(strand_under_drop_oldest)->Iterations(200);
+
+    // Heap allocations a steady state run_and_ignore makes, the closure is
+    // the size of a player button callback
+    void allocations_per_submission(benchmark::State &state) {
+        auto &pool = shared_pool();
+        std::atomic_uint64_t done{ 0 };
+        uint64_t submitted = 0;
+
+        std::array<char, 48> captured{};
+
+        // Warm the node pools and inboxes first
+        for (int i = 0; i < 1024; ++i) {
+            (void) pool.run_and_ignore([&done, captured] {
+                benchmark::DoNotOptimize(captured);
+                done.fetch_add(1, std::memory_order_release);
+            });
+        }
+
+        wait_for(done, 1024);
+        done = 0;
+
+        auto before = allocations.load(std::memory_order_relaxed);
+
+        for (auto _ : state) {
+            if (pool.run_and_ignore([&done, captured] {
+                    benchmark::DoNotOptimize(captured);
+                    done.fetch_add(1, std::memory_order_release);
+                })) {
+                ++submitted;
+            }
+        }
+
+        wait_for(done, submitted);
+
+        auto made = allocations.load(std::memory_order_relaxed) - before;
+        state.counters["allocs_per_task"] = benchmark::Counter(static_cast<double>(made) / static_cast<double>(submitted));
+    }
+
+    BENCHMARK(allocations_per_submission);
+
+    // A short lived string per task, from the global heap and from the
+    // worker's arena
+    template <bool UseArena>
+    void task_scratch_allocations(benchmark::State &state) {
+        auto &pool = shared_pool();
+        std::atomic_uint64_t done{ 0 };
+        uint64_t submitted = 0;
+
+        auto body = [&done] {
+            if constexpr (UseArena) {
+                std::pmr::string path{ async::thread_pool::task_arena() };
+                path.append(200, 'x');
+                benchmark::DoNotOptimize(path.data());
+            }
+            else {
+                std::string path(200, 'x');
+                benchmark::DoNotOptimize(path.data());
+            }
+
+            done.fetch_add(1, std::memory_order_release);
+        };
+
+        for (int i = 0; i < 1024; ++i) {
+            (void) pool.run_and_ignore(body);
+        }
+
+        wait_for(done, 1024);
+        done = 0;
+
+        auto before = allocations.load(std::memory_order_relaxed);
+
+        for (auto _ : state) {
+            if (pool.run_and_ignore(body)) {
+                ++submitted;
+            }
+        }
+
+        wait_for(done, submitted);
+
+        auto made = allocations.load(std::memory_order_relaxed) - before;
+        state.counters["allocs_per_task"] = benchmark::Counter(static_cast<double>(made) / static_cast<double>(submitted));
+        state.SetItemsProcessed(static_cast<int64_t>(submitted));
+    }
+
+    BENCHMARK(task_scratch_allocations<false>)->Name("task_scratch_allocations/global_heap");
+    BENCHMARK(task_scratch_allocations<true>)->Name("task_scratch_allocations/task_arena");
+
+    // promise, then() and set_value with the continuation run inline, what a
+    // completion costs without any queueing
+    void future_then_completion(benchmark::State &state) {
+        for (auto _ : state) {
+            async::promise<int> prms;
+            auto chained = prms.get_future().then(async::inline_executor(), [](int value) {
+                return value + 1;
+            });
+
+            prms.set_value(1);
+            benchmark::DoNotOptimize(chained.get());
+        }
+    }
+
+    BENCHMARK(future_then_completion);
+
+    void future_when_all(benchmark::State &state) {
+        auto count = static_cast<std::size_t>(state.range(0));
+
+        for (auto _ : state) {
+            std::vector<async::promise<int>> promises(count);
+            std::vector<async::future<int>> futures;
+            futures.reserve(count);
+
+            for (auto &prms : promises) {
+                futures.push_back(prms.get_future());
+            }
+
+            auto all = async::when_all(std::move(futures));
+
+            for (auto &prms : promises) {
+                prms.set_value(1);
+            }
+
+            benchmark::DoNotOptimize(all.get());
+        }
+
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+    }
+
+    BENCHMARK(future_when_all)->Range(2, 64);
+
+    // Scheduling and firing many one shot timers (debounces, retries) on a
+    // manual clock, so only the scheduler's own cost is measured
+    void context_once_after_timers(benchmark::State &state) {
+        auto count = state.range(0);
+
+        async::manual_clock clock;
+        async::context ctx{ clock, 2, {}, 1 };
+        ctx.initialize();
+
+        std::atomic_uint64_t fired{ 0 };
+        std::size_t dispatched = 0;
+
+        for (auto _ : state) {
+            for (int64_t i = 0; i < count; ++i) {
+                ctx.schedule(async::schedule_policy::once_after(std::chrono::milliseconds(i % 1000)), [&fired] {
+                    fired.fetch_add(1, std::memory_order_relaxed);
+                });
+            }
+
+            dispatched += ctx.advance(std::chrono::seconds(1));
+        }
+
+        state.SetItemsProcessed(state.iterations() * count);
+        state.counters["dispatched"] = benchmark::Counter(static_cast<double>(dispatched));
+
+        ctx.join();
+    }
+
+    BENCHMARK(context_once_after_timers)->RangeMultiplier(4)->Range(1024, 65536)->Unit(benchmark::kMillisecond);
+
+    // An hour of the player's periodic timers in virtual time
+    void context_virtual_hour(benchmark::State &state) {
+        std::size_t dispatched = 0;
+        uint64_t wakeups = 0;
+
+        for (auto _ : state) {
+            async::manual_clock clock;
+            async::context ctx{ clock, 2, {}, 1 };
+            ctx.initialize();
+
+            ctx.schedule(async::schedule_policy::every(std::chrono::milliseconds(250), std::chrono::milliseconds(50)), [] { });
+            ctx.schedule(async::schedule_policy::every(std::chrono::milliseconds(750), std::chrono::milliseconds(250)), [] { });
+            ctx.schedule(async::schedule_policy::every(std::chrono::seconds(30), std::chrono::seconds(5)), [] { });
+
+            for (int minute = 0; minute < 60; ++minute) {
+                dispatched += ctx.advance(std::chrono::minutes(1));
+            }
+
+            wakeups += ctx.snapshot().timer_wakeups;
+            ctx.join();
+        }
+
+        state.counters["dispatched"] = benchmark::Counter(static_cast<double>(dispatched), benchmark::Counter::kAvgIterations);
+        state.counters["wakeups"] = benchmark::Counter(static_cast<double>(wakeups), benchmark::Counter::kAvgIterations);
+        state.counters["per_dispatch"] = benchmark::Counter(
+            static_cast<double>(dispatched),
+            benchmark::Counter::kIsRate | benchmark::Counter::kInvert
+        );
+    }
+
+    BENCHMARK(context_virtual_hour)->Unit(benchmark::kMillisecond);
+
+}    // namespace
+
+int main(int argc, char **argv) {
+    spdlog::set_level(spdlog::level::warn);
+
+    benchmark::Initialize(&argc, argv);
+
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+
+    return 0;
+}
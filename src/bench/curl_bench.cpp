@@ -0,0 +1,318 @@
+#include <array>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <string_view>
+
+#include <poll.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include <benchmark/benchmark.h>
+
+#include <fmt/format.h>
+
+#include <arti/curl/engine.hpp>
+#include <arti/curl/client.hpp>
+#include <arti/curl/body_pool.hpp>
+#include <arti/curl/connection.hpp>
+#include <arti/curl/connection_pool.hpp>
+
+namespace curl = arti::curl;
+
+namespace {
+
+    // Album art sized body, served for paths starting with /image
+    constexpr std::size_t large_body_size = 300 * 1024;
+
+    // Keep-alive HTTP/1.1 server on loopback answering every request with a
+    // small JSON body, so only the client side connection handling differs
+    // between benchmarks
+    struct loopback_server {
+        loopback_server()
+            : large_reply(fmt::format("HTTP/1.1 200 OK\r\nContent-Type: image/jpeg\r\nContent-Length: {}\r\n\r\n", large_body_size)) {
+            large_reply.append(large_body_size, 'x');
+
+            listener = ::socket(AF_INET, SOCK_STREAM, 0);
+
+            int reuse = 1;
+            ::setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+            sockaddr_in addr{};
+            addr.sin_family = AF_INET;
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            addr.sin_port = 0;
+
+            ::bind(listener, reinterpret_cast<sockaddr *>(&addr), sizeof(addr));
+            ::listen(listener, 128);
+
+            socklen_t len = sizeof(addr);
+            ::getsockname(listener, reinterpret_cast<sockaddr *>(&addr), &len);
+            port = ntohs(addr.sin_port);
+
+            worker = std::thread([this] {
+                serve();
+            });
+        }
+
+        ~loopback_server() {
+            running = false;
+            worker.join();
+
+            for (auto &client : clients) {
+                ::close(client.fd);
+            }
+
+            ::close(listener);
+        }
+
+        std::string url(std::string_view path) const {
+            return fmt::format("http://127.0.0.1:{}{}", port, path);
+        }
+
+      private:
+        struct client {
+            int fd;
+            std::string pending;
+        };
+
+        void serve() {
+            static constexpr std::string_view reply =
+                "HTTP/1.1 200 OK\r\n"
+                "Content-Type: application/json\r\n"
+                "Content-Length: 16\r\n"
+                "\r\n"
+                "{\"is_playing\":1}";
+
+            std::vector<pollfd> fds;
+            std::array<char, 4096> buffer;
+
+            while (running) {
+                fds.clear();
+                fds.push_back({ listener, POLLIN, 0 });
+
+                for (auto &client : clients) {
+                    fds.push_back({ client.fd, POLLIN, 0 });
+                }
+
+                if (::poll(fds.data(), fds.size(), 50) <= 0) {
+                    continue;
+                }
+
+                if (fds[0].revents & POLLIN) {
+                    clients.push_back({ ::accept(listener, nullptr, nullptr), {} });
+                }
+
+                for (std::size_t i = 1; i < fds.size(); ++i) {
+                    if (not (fds[i].revents & (POLLIN | POLLHUP))) {
+                        continue;
+                    }
+
+                    auto &client = clients[i - 1];
+                    auto got = ::read(client.fd, buffer.data(), buffer.size());
+
+                    if (got <= 0) {
+                        ::close(client.fd);
+                        client.fd = -1;
+                        continue;
+                    }
+
+                    client.pending.append(buffer.data(), static_cast<std::size_t>(got));
+
+                    // Requests here have no body, the end of the headers ends them
+                    for (auto end = client.pending.find("\r\n\r\n"); end != std::string::npos; end = client.pending.find("\r\n\r\n")) {
+                        std::string_view answer = client.pending.starts_with("GET /image") ? large_reply : reply;
+                        client.pending.erase(0, end + 4);
+
+                        send_all(client.fd, answer);
+                    }
+                }
+
+                std::erase_if(clients, [](const client &client) {
+                    return client.fd < 0;
+                });
+            }
+        }
+
+        // The large reply doesn't fit the socket buffer in one write
+        static void send_all(int fd, std::string_view data) {
+            while (not data.empty()) {
+                pollfd out{ fd, POLLOUT, 0 };
+                ::poll(&out, 1, 1000);
+
+                auto sent = ::write(fd, data.data(), data.size());
+
+                if (sent <= 0) {
+                    return;
+                }
+
+                data.remove_prefix(static_cast<std::size_t>(sent));
+            }
+        }
+
+        int listener;
+        uint16_t port;
+
+        std::string large_reply;
+
+        std::vector<client> clients;
+        std::atomic_bool running{ true };
+        std::thread worker;
+    };
+
+    loopback_server &server() {
+        static loopback_server instance;
+        return instance;
+    }
+
+    // What every request paid before the pool, a new handle and connection
+    void request_fresh_connection(benchmark::State &state) {
+        auto url = server().url("/v1/me/player");
+
+        for (auto _ : state) {
+            curl::connection conn;
+
+            if (auto init = conn.initialize(""); not init) {
+                state.SkipWithError(init.error().c_str());
+                break;
+            }
+
+            benchmark::DoNotOptimize(conn.get(url));
+        }
+
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    // Limited so closed connections waiting in TIME_WAIT don't run the
+    // loopback out of ports
+    BENCHMARK(request_fresh_connection)->Iterations(2000)->Unit(benchmark::kMicrosecond);
+
+    // request::get, the handle and its connection come from the pool
+    void request_pooled_connection(benchmark::State &state) {
+        auto url = server().url("/v1/me/player");
+
+        auto before = curl::connection_pool::global().stats();
+
+        for (auto _ : state) {
+            benchmark::DoNotOptimize(curl::request::get(url));
+        }
+
+        auto after = curl::connection_pool::global().stats();
+
+        state.SetItemsProcessed(state.iterations());
+        state.counters["handles_created"] = benchmark::Counter(static_cast<double>(after.created - before.created));
+        state.counters["reused"] = benchmark::Counter(static_cast<double>(after.reused - before.reused));
+    }
+
+    BENCHMARK(request_pooled_connection)->Iterations(2000)->Unit(benchmark::kMicrosecond);
+
+    // Player poll and button commands racing on the same host
+    void request_pooled_concurrent(benchmark::State &state) {
+        auto url = server().url("/v1/me/player");
+
+        for (auto _ : state) {
+            benchmark::DoNotOptimize(curl::request::get(url));
+        }
+
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    BENCHMARK(request_pooled_concurrent)->Threads(4)->Iterations(500)->UseRealTime()->Unit(benchmark::kMicrosecond);
+
+    // A burst of requests in flight at once on the engine's single event
+    // thread, what a poll, saved checks and artwork racing look like
+    void engine_concurrent_burst(benchmark::State &state) {
+        auto url = server().url("/v1/me/player");
+        auto burst = static_cast<int>(state.range(0));
+
+        for (auto _ : state) {
+            std::atomic_int left{ burst };
+
+            for (int i = 0; i < burst; ++i) {
+                curl::engine::global().submit({ .url = url }, [&left](curl::request_result result) {
+                    benchmark::DoNotOptimize(result);
+
+                    if (left.fetch_sub(1, std::memory_order_release) == 1) {
+                        left.notify_one();
+                    }
+                });
+            }
+
+            // Sleeps instead of spinning, a spinning waiter starves the event
+            // thread and the server on a small machine
+            for (auto remaining = left.load(std::memory_order_acquire); remaining > 0; remaining = left.load(std::memory_order_acquire)) {
+                left.wait(remaining, std::memory_order_acquire);
+            }
+        }
+
+        auto stats = curl::engine::global().stats();
+
+        state.SetItemsProcessed(state.iterations() * burst);
+        state.counters["connections"] = benchmark::Counter(static_cast<double>(stats.connections));
+        state.counters["peak_in_flight"] = benchmark::Counter(static_cast<double>(stats.peak_in_flight));
+    }
+
+    BENCHMARK(engine_concurrent_burst)->RangeMultiplier(4)->Range(1, 64)->UseRealTime()->Unit(benchmark::kMicrosecond);
+
+    // What every response paid before the body pool, std::string growing
+    // chunk by chunk
+    std::size_t append_body(void *data, std::size_t size, std::size_t nmemb, void *user_data) {
+        auto *resp = static_cast<curl::response *>(user_data);
+        auto capacity = resp->body.capacity();
+
+        resp->body.append(static_cast<char *>(data), size * nmemb);
+
+        if (resp->body.capacity() != capacity) {
+            ++resp->body_allocations;
+        }
+
+        return size * nmemb;
+    }
+
+    // Album art over a pooled connection, args: whether the body pool is used
+    void request_large_body(benchmark::State &state) {
+        auto url = server().url("/image/cover.jpg");
+        auto pooled = state.range(0) != 0;
+
+        uint64_t allocations = 0;
+
+        for (auto _ : state) {
+            curl::connection conn;
+
+            if (auto init = conn.initialize("", curl::connection_pool::global().acquire(url).value()); not init) {
+                state.SkipWithError(init.error().c_str());
+                break;
+            }
+
+            if (not pooled) {
+                conn.set_write_function(append_body);
+            }
+
+            auto image = conn.get(url);
+
+            if (not image or image->body.size() != large_body_size) {
+                state.SkipWithError("Unexpected image response");
+                break;
+            }
+
+            allocations += image->body_allocations;
+
+            // Done with it like the decoder would be
+            if (pooled) {
+                curl::body_pool::global().recycle(std::move(image->body));
+            }
+        }
+
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * large_body_size));
+        state.counters["body_allocations"] = benchmark::Counter(static_cast<double>(allocations), benchmark::Counter::kAvgIterations);
+    }
+
+    BENCHMARK(request_large_body)->Arg(0)->Arg(1)->Iterations(500)->Unit(benchmark::kMicrosecond);
+
+}    // namespace
+
+BENCHMARK_MAIN();
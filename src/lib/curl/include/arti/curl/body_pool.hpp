@@ -0,0 +1,67 @@
+#pragma once
+
+#include <array>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace arti::curl {
+
+    // Recycled response body buffers in a few size classes, so a request
+    // reuses the capacity an earlier one of similar size already allocated
+    // instead of growing a new string chunk by chunk
+    class body_pool {
+      public:
+        struct statistics {
+            // acquire() served from a recycled buffer, or had to allocate
+            uint64_t hits;
+            uint64_t misses;
+
+            // recycle() kept the buffer, or freed it for being larger than
+            // every class or its class being full
+            uint64_t recycled;
+            uint64_t dropped;
+
+            std::size_t pooled_bytes;
+        };
+
+        static constexpr std::array<std::size_t, 6> size_classes{
+            4 * 1024,
+            16 * 1024,
+            64 * 1024,
+            256 * 1024,
+            1024 * 1024,
+            4 * 1024 * 1024
+        };
+
+        static constexpr std::size_t max_per_class = 8;
+
+        body_pool();
+
+        body_pool(body_pool &&) = delete;
+        body_pool &operator=(body_pool &&) = delete;
+
+        body_pool(const body_pool &) = delete;
+        body_pool &operator=(const body_pool &) = delete;
+
+        static body_pool &global();
+
+        // Empty buffer with room for at least size_hint bytes. Increments
+        // *allocations when it wasn't served from a recycled one
+        std::string acquire(std::size_t size_hint, uint32_t *allocations = nullptr);
+
+        // Keeps the capacity of a buffer nobody reads anymore
+        void recycle(std::string buffer) noexcept;
+
+        statistics stats() const;
+
+      private:
+        mutable std::mutex mtx;
+        std::array<std::vector<std::string>, size_classes.size()> free_lists;
+
+        statistics counters{};
+    };
+
+}    // namespace arti::curl
@@ -2,6 +2,7 @@
 
 #include <map>
 #include <string>
+#include <cstdint>
 
 #include <curl/curl.h>
 
@@ -15,6 +16,10 @@ namespace arti::curl {
         int code;
         std::string body;
         header_fields headers;
+
+        // Heap allocations made for body, none when Content-Length was known
+        // and a recycled buffer of that size was available
+        uint32_t body_allocations = 0;
     };
 
     struct request {
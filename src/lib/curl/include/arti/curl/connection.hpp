@@ -8,6 +8,7 @@
 #include <curl/curl.h>
 
 #include <arti/curl/client.hpp>
+#include <arti/curl/connection_pool.hpp>
 
 namespace arti::curl {
 
@@ -65,6 +66,10 @@ namespace arti::curl {
 
         expected<> initialize(std::string_view base_url);
 
+        // Uses the leased handle instead of a new one, it goes back to the pool
+        // on terminate()
+        expected<> initialize(std::string_view base_url, connection_pool::lease handle);
+
         void terminate();
 
         void set_basic_auth(std::string_view username, std::string_view password);
@@ -126,10 +131,13 @@ namespace arti::curl {
         expected<response, response_error> options(std::string_view url);
 
       private:
+        void set_defaults(std::string_view base_url);
+
         expected<response, response_error> perform_curl_request(std::string_view uri);
 
         bool verify_peer;
         CURL *curl_handle = nullptr;
+        connection_pool::lease pooled;
         write_callback connection_write_callback;
         std::string ca_info_file_path;
         std::array<char, CURL_ERROR_SIZE> curl_error_buffer;
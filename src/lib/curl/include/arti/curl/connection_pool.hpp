@@ -0,0 +1,121 @@
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <string_view>
+#include <condition_variable>
+
+#include <curl/curl.h>
+
+#include <arti/curl/error.hpp>
+
+namespace arti::curl {
+
+    struct pool_options {
+        // Easy handles (and so open connections) a single host may have at
+        // once, acquiring past it waits for one to be released
+        std::size_t max_per_host = 4;
+
+        // Idle handles unused for longer are closed
+        std::chrono::seconds idle_timeout{ 60 };
+    };
+
+    // Keeps easy handles alive between requests. libcurl caches the connection
+    // inside the handle, so reusing one skips DNS, TCP and the TLS handshake.
+    // Handles are keyed by scheme, host and port
+    class connection_pool {
+      public:
+        struct statistics {
+            uint64_t reused;
+            uint64_t created;
+            uint64_t evicted;
+            uint64_t waited;
+
+            std::size_t idle;
+            std::size_t in_use;
+        };
+
+        // Owns a handle until destroyed, then gives it back to the pool
+        class lease {
+          public:
+            lease() noexcept = default;
+            ~lease();
+
+            lease(lease &&other) noexcept;
+            lease &operator=(lease &&other) noexcept;
+
+            lease(const lease &) = delete;
+            lease &operator=(const lease &) = delete;
+
+            CURL *get() const noexcept;
+
+            explicit operator bool() const noexcept;
+
+          private:
+            friend class connection_pool;
+
+            lease(connection_pool *owner, std::string key, CURL *handle) noexcept;
+
+            void release() noexcept;
+
+            connection_pool *pool = nullptr;
+            std::string host_key;
+            CURL *curl_handle = nullptr;
+        };
+
+        explicit connection_pool(pool_options opts = {});
+        ~connection_pool();
+
+        connection_pool(connection_pool &&) = delete;
+        connection_pool &operator=(connection_pool &&) = delete;
+
+        connection_pool(const connection_pool &) = delete;
+        connection_pool &operator=(const connection_pool &) = delete;
+
+        // The pool request::get, post and the rest take their handles from
+        static connection_pool &global();
+
+        // The most recently used idle handle for url's host, a new one if there
+        // is none and the host is under max_per_host
+        expected<lease> acquire(std::string_view url);
+
+        statistics stats() const;
+
+        // "scheme://host:port", the port filled in from the scheme if missing
+        static std::string key_for(std::string_view url);
+
+      private:
+        struct idle_handle {
+            CURL *handle;
+            std::chrono::steady_clock::time_point since;
+        };
+
+        struct host {
+            std::vector<idle_handle> idle;
+            std::size_t in_use = 0;
+        };
+
+        void release(const std::string &key, CURL *handle) noexcept;
+
+        // Moves expired idle handles into expired, the caller cleans them up
+        // once the lock is released
+        void collect_expired(std::chrono::steady_clock::time_point now, std::vector<CURL *> &expired);
+
+        pool_options options;
+
+        mutable std::mutex mtx;
+        std::condition_variable released;
+        std::map<std::string, host, std::less<>> hosts;
+
+        uint64_t reused;
+        uint64_t created;
+        uint64_t evicted;
+        uint64_t waited;
+    };
+
+}    // namespace arti::curl
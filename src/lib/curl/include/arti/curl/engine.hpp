@@ -0,0 +1,161 @@
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <optional>
+#include <coroutine>
+#include <functional>
+#include <unordered_map>
+
+#include <curl/curl.h>
+
+#include <arti/curl/client.hpp>
+
+namespace arti::curl {
+
+    struct http_request {
+        std::string method = "GET";
+        std::string url;
+        header_fields headers;
+
+        // Sent as is, with its length, for any method but GET and HEAD
+        std::string body;
+
+        // Seconds, 0 waits for as long as the transfer takes
+        int timeout = 0;
+    };
+
+    using request_result = expected<response, response_error>;
+    using completion_callback = std::function<void(request_result)>;
+
+    struct engine_options {
+        // Open connections per host and in total, kept alive between requests
+        long max_host_connections = 4;
+        long max_total_connections = 32;
+
+        // Streams one HTTP/2 connection carries at once, transfers past it wait
+        // for a free stream or open another connection
+        long max_concurrent_streams = 100;
+    };
+
+    // Runs every transfer on one event thread with curl_multi, so waiting on
+    // the network holds no worker. Completions, callbacks and resumed
+    // coroutines alike, run on that thread, anything heavier than handing the
+    // response over should move elsewhere first
+    class engine {
+      public:
+        explicit engine(engine_options opts = {});
+        ~engine();
+
+        engine(engine &&) = delete;
+        engine &operator=(engine &&) = delete;
+
+        engine(const engine &) = delete;
+        engine &operator=(const engine &) = delete;
+
+        // Started the first time it's used, stopped at exit
+        static engine &global();
+
+        // Fails whatever is still in flight and joins the event thread,
+        // submitting afterwards fails right away
+        void stop();
+
+        void submit(http_request request, completion_callback on_done);
+
+        std::future<request_result> submit(http_request request);
+
+        // co_await engine.send(request), resumes on the event thread
+        class request_operation {
+          public:
+            bool await_ready() const noexcept {
+                return false;
+            }
+
+            void await_suspend(std::coroutine_handle<> handle) {
+                owner->submit(std::move(request), [this, handle](request_result done) {
+                    result.emplace(std::move(done));
+                    handle.resume();
+                });
+            }
+
+            request_result await_resume() {
+                return std::move(*result);
+            }
+
+          private:
+            friend class engine;
+
+            request_operation(engine *target, http_request req)
+                : owner(target)
+                , request(std::move(req)) { }
+
+            engine *owner;
+            http_request request;
+            std::optional<request_result> result;
+        };
+
+        request_operation send(http_request request);
+
+        struct statistics {
+            uint64_t completed;
+            uint64_t failed;
+
+            // Responses by the protocol the server answered with
+            uint64_t http2_responses;
+            uint64_t http1_responses;
+
+            // Connections opened, every other transfer rode an existing one.
+            // completed / connections is how many streams each one carried
+            uint64_t connections;
+
+            std::size_t in_flight;
+            std::size_t peak_in_flight;
+        };
+
+        statistics stats() const;
+
+      private:
+        struct transfer;
+
+        void run();
+
+        void start(std::unique_ptr<transfer> pending);
+        void finish(CURL *handle, CURLcode code);
+
+        // Runs a completion callback, an exception escaping it is logged instead
+        // of taking down the event thread
+        static void complete(completion_callback &on_done, request_result result);
+
+        CURL *take_handle();
+
+        engine_options options;
+
+        CURLM *multi;
+
+        std::mutex submit_mtx;
+        std::vector<std::unique_ptr<transfer>> submitted;
+
+        // Event thread only
+        std::vector<CURL *> spare_handles;
+        std::unordered_map<CURL *, std::unique_ptr<transfer>> active;
+
+        // Written on the event thread, read by stats()
+        std::atomic_uint64_t completed;
+        std::atomic_uint64_t failed;
+        std::atomic_uint64_t http2_responses;
+        std::atomic_uint64_t http1_responses;
+        std::atomic_uint64_t connections;
+        std::atomic_size_t in_flight;
+        std::atomic_size_t peak_in_flight;
+
+        std::atomic_bool stopping;
+        std::thread event_thread;
+    };
+
+}    // namespace arti::curl
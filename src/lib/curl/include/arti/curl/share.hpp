@@ -0,0 +1,61 @@
+#pragma once
+
+#include <array>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+
+#include <curl/curl.h>
+
+namespace arti::curl {
+
+    // Process wide CURLSH every connection and engine transfer attaches to, so
+    // the DNS cache and TLS sessions are shared across threads. A new
+    // connection to a host seen before resumes its TLS session
+    class share {
+      public:
+        struct statistics {
+            // TLS handshakes on new connections, by whether the server took the
+            // cached session. unknown when the TLS backend can't tell
+            uint64_t resumed_handshakes;
+            uint64_t full_handshakes;
+            uint64_t unknown_handshakes;
+
+            // New connections without TLS
+            uint64_t plain_connections;
+        };
+
+        ~share();
+
+        share(share &&) = delete;
+        share &operator=(share &&) = delete;
+
+        share(const share &) = delete;
+        share &operator=(const share &) = delete;
+
+        static share &global();
+
+        // Sets CURLOPT_SHARE and the callback counting handshakes. curl_easy_reset
+        // clears the callback, call it again for every request on the handle
+        void attach(CURL *handle);
+
+        statistics stats() const;
+
+      private:
+        share();
+
+        static void lock(CURL *handle, curl_lock_data data, curl_lock_access access, void *user_data);
+        static void unlock(CURL *handle, curl_lock_data data, void *user_data);
+
+        static int on_connected(void *user_data, char *primary_ip, char *local_ip, int primary_port, int local_port);
+
+        CURLSH *share_handle;
+        std::array<std::mutex, CURL_LOCK_DATA_LAST> locks;
+
+        std::atomic_uint64_t resumed;
+        std::atomic_uint64_t full;
+        std::atomic_uint64_t unknown;
+        std::atomic_uint64_t plain;
+    };
+
+}    // namespace arti::curl
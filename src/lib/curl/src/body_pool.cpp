@@ -0,0 +1,95 @@
+#include <arti/curl/body_pool.hpp>
+
+#include <algorithm>
+
+namespace arti::curl {
+
+    body_pool::body_pool() {
+        // recycle() then never allocates while holding the lock
+        for (auto &free_list : free_lists) {
+            free_list.reserve(max_per_class);
+        }
+    }
+
+    body_pool &body_pool::global() {
+        static body_pool pool;
+        return pool;
+    }
+
+    std::string body_pool::acquire(std::size_t size_hint, uint32_t *allocations) {
+        // Smallest class the hint fits in, any buffer there is large enough
+        auto klass = std::lower_bound(size_classes.begin(), size_classes.end(), size_hint);
+
+        if (klass != size_classes.end()) {
+            auto index = static_cast<std::size_t>(klass - size_classes.begin());
+
+            std::unique_lock lock(mtx);
+
+            if (auto &free_list = free_lists[index]; not free_list.empty()) {
+                auto buffer = std::move(free_list.back());
+                free_list.pop_back();
+
+                ++counters.hits;
+                counters.pooled_bytes -= buffer.capacity();
+
+                return buffer;
+            }
+
+            ++counters.misses;
+            lock.unlock();
+
+            size_hint = *klass;
+        }
+        else {
+            std::scoped_lock lock(mtx);
+            ++counters.misses;
+        }
+
+        if (allocations) {
+            ++*allocations;
+        }
+
+        std::string buffer;
+        buffer.reserve(size_hint);
+
+        return buffer;
+    }
+
+    void body_pool::recycle(std::string buffer) noexcept {
+        auto capacity = buffer.capacity();
+
+        // Largest class the buffer still fills, what acquire() will expect of it
+        auto klass = std::upper_bound(size_classes.begin(), size_classes.end(), capacity);
+
+        // Never came from the pool, an empty or short inline string
+        if (klass == size_classes.begin()) {
+            return;
+        }
+
+        std::scoped_lock lock(mtx);
+
+        if (capacity > size_classes.back()) {
+            ++counters.dropped;
+            return;
+        }
+
+        auto &free_list = free_lists[static_cast<std::size_t>(klass - size_classes.begin()) - 1];
+
+        if (free_list.size() >= max_per_class) {
+            ++counters.dropped;
+            return;
+        }
+
+        buffer.clear();
+        free_list.push_back(std::move(buffer));
+
+        ++counters.recycled;
+        counters.pooled_bytes += capacity;
+    }
+
+    body_pool::statistics body_pool::stats() const {
+        std::scoped_lock lock(mtx);
+        return counters;
+    }
+
+}    // namespace arti::curl
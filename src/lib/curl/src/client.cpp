@@ -1,6 +1,35 @@
 #include <arti/curl/client.hpp>
 
 #include <arti/curl/connection.hpp>
+#include <arti/curl/connection_pool.hpp>
+
+namespace {
+
+    using namespace arti::curl;
+
+    // Back to back requests to a host reuse a warm connection from the shared
+    // pool instead of paying DNS, TCP and TLS again
+    expected<void, response_error> open_pooled(connection &conn, std::string_view url) {
+        auto handle = connection_pool::global().acquire(url);
+
+        if (not handle) {
+            return error<response_error>{{
+                .code = -1,
+                .message = handle.error()
+            }};
+        }
+
+        if (auto init = conn.initialize("", std::move(*handle)); not init) {
+            return error<response_error>{{
+                .code = -1,
+                .message = init.error()
+            }};
+        }
+
+        return {};
+    }
+
+}    // namespace
 
 namespace arti::curl {
 
@@ -35,11 +64,8 @@ namespace arti::curl {
     expected<response, response_error> request::get(std::string_view url, header_fields headers) {
         connection conn;
 
-        if (auto init = conn.initialize(""); not init) {
-            return error<response_error>{{
-                .code = -1,
-                .message = init.error()
-            }};
+        if (auto init = open_pooled(conn, url); not init) {
+            return error<response_error>{ init.error() };
         }
 
         for (const auto &[k, v] : headers) {
@@ -52,11 +78,8 @@ namespace arti::curl {
     expected<response, response_error> request::post(std::string_view url, std::string_view content_type, std::string_view data, header_fields headers) {
         connection conn;
 
-        if (auto init = conn.initialize(""); not init) {
-            return error<response_error>{{
-                .code = -1,
-                .message = init.error()
-            }};
+        if (auto init = open_pooled(conn, url); not init) {
+            return error<response_error>{ init.error() };
         }
 
         conn.append_header("Content-Type", std::string{ content_type });
@@ -71,11 +94,8 @@ namespace arti::curl {
     expected<response, response_error> request::put(std::string_view url, std::string_view content_type, std::string_view data, header_fields headers) {
         connection conn;
 
-        if (auto init = conn.initialize(""); not init) {
-            return error<response_error>{{
-                .code = -1,
-                .message = init.error()
-            }};
+        if (auto init = open_pooled(conn, url); not init) {
+            return error<response_error>{ init.error() };
         }
 
         conn.append_header("Content-Type", std::string{ content_type });
@@ -90,11 +110,8 @@ namespace arti::curl {
     expected<response, response_error> request::patch(std::string_view url, std::string_view content_type, std::string_view data, header_fields headers) {
         connection conn;
 
-        if (auto init = conn.initialize(""); not init) {
-            return error<response_error>{{
-                .code = -1,
-                .message = init.error()
-            }};
+        if (auto init = open_pooled(conn, url); not init) {
+            return error<response_error>{ init.error() };
         }
 
         conn.append_header("Content-Type", std::string{ content_type });
@@ -109,11 +126,8 @@ namespace arti::curl {
     expected<response, response_error> request::del(std::string_view url, header_fields headers) {
         connection conn;
 
-        if (auto init = conn.initialize(""); not init) {
-            return error<response_error>{{
-                .code = -1,
-                .message = init.error()
-            }};
+        if (auto init = open_pooled(conn, url); not init) {
+            return error<response_error>{ init.error() };
         }
 
         for (const auto &[k, v] : headers) {
@@ -124,13 +138,10 @@ namespace arti::curl {
 	}
 
     expected<response, response_error> request::head(std::string_view url, header_fields headers) {
-         connection conn;
+        connection conn;
 
-        if (auto init = conn.initialize(""); not init) {
-            return error<response_error>{{
-                .code = -1,
-                .message = init.error()
-            }};
+        if (auto init = open_pooled(conn, url); not init) {
+            return error<response_error>{ init.error() };
         }
 
         for (const auto &[k, v] : headers) {
@@ -141,13 +152,10 @@ namespace arti::curl {
 	}
 
     expected<response, response_error> request::options(std::string_view url, header_fields headers) {
-         connection conn;
+        connection conn;
 
-        if (auto init = conn.initialize(""); not init) {
-            return error<response_error>{{
-                .code = -1,
-                .message = init.error()
-            }};
+        if (auto init = open_pooled(conn, url); not init) {
+            return error<response_error>{ init.error() };
         }
 
         for (const auto &[k, v] : headers) {
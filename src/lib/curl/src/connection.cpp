@@ -3,65 +3,14 @@
 #include <algorithm>
 
 #include <arti/curl/info.hpp>
+#include <arti/curl/share.hpp>
+#include <arti/curl/body_pool.hpp>
+
+#include "transfer_callbacks.hpp"
 
 #include <fmt/format.h>
 #include <spdlog/spdlog.h>
 
-static size_t write_callback_helper(void *data, size_t size, size_t nmemb, void *user_data) {
-    arti::curl::response *resp = reinterpret_cast<arti::curl::response *>(user_data);
-    resp->body.append(reinterpret_cast<char*>(data), size * nmemb);
-    return (size * nmemb);
-}
-
-static inline void ltrim(std::string &s) {
-    s.erase(s.begin(), std::find_if(s.begin(), s.end(), [](unsigned char ch) {
-        return !std::isspace(ch);
-    }));
-}
-
-// trim from end (in place)
-static inline void rtrim(std::string &s) {
-    s.erase(std::find_if(s.rbegin(), s.rend(), [](unsigned char ch) {
-        return !std::isspace(ch);
-    }).base(), s.end());
-}
-
-// trim from both ends (in place)
-static inline void trim(std::string &s) {
-    rtrim(s);
-    ltrim(s);
-}
-
-
-size_t header_callback(void *data, size_t size, size_t nmemb, void *user_data) {
-    arti::curl::response *resp = reinterpret_cast<arti::curl::response *>(user_data);
-
-    std::string header{ reinterpret_cast<char*>(data), size * nmemb };
-
-    size_t separator = header.find_first_of(':');
-
-    if (separator == std::string::npos) {
-        trim(header);
-
-        if (header.empty()) {
-            return (size * nmemb);
-        }
-
-        resp->headers[header] = "present";
-    }
-    else {
-        std::string key = header.substr(0, separator);
-        std::string value = header.substr(separator + 1);
-
-        trim(key);
-        trim(value);
-
-        resp->headers[key] = std::move(value);
-    }
-
-    return (size * nmemb);
-}
-
 struct upload_object {
     const char *data;
     size_t size;
@@ -93,6 +42,25 @@ namespace arti::curl {
             return error<>{ "Couldn't initialize curl handle" };
         }
 
+        set_defaults(base_url);
+
+        return {};
+    }
+
+    expected<> connection::initialize(std::string_view base_url, connection_pool::lease handle) {
+        if (not handle) {
+            return error<>{ "Couldn't initialize curl handle, empty lease" };
+        }
+
+        pooled = std::move(handle);
+        curl_handle = pooled.get();
+
+        set_defaults(base_url);
+
+        return {};
+    }
+
+    void connection::set_defaults(std::string_view base_url) {
         connection_info.base_url = base_url;
         connection_info.timeout = 0;
         connection_info.max_redirects = -1;
@@ -102,13 +70,15 @@ namespace arti::curl {
 
         verify_peer = true;
 
-        connection_write_callback = write_callback_helper;
-
-        return {};
+        connection_write_callback = detail::write_body;
     }
 
     void connection::terminate() {
-        if (curl_handle) {
+        if (pooled) {
+            // Reset and kept by the pool, with its connection still open
+            pooled = {};
+        }
+        else if (curl_handle) {
             curl_easy_cleanup(curl_handle);
         }
 
@@ -312,9 +282,12 @@ namespace arti::curl {
         curl_slist *header_list = nullptr;
 
         curl_easy_setopt(curl_handle, CURLOPT_URL, url.c_str());
+
+        share::global().attach(curl_handle);
+
         curl_easy_setopt(curl_handle, CURLOPT_WRITEFUNCTION, connection_write_callback);
         curl_easy_setopt(curl_handle, CURLOPT_WRITEDATA, &resp);
-        curl_easy_setopt(curl_handle, CURLOPT_HEADERFUNCTION, ::header_callback);
+        curl_easy_setopt(curl_handle, CURLOPT_HEADERFUNCTION, detail::write_header);
         curl_easy_setopt(curl_handle, CURLOPT_HEADERDATA, &resp);
 
         for (const auto &[k, v] : connection_info.headers) {
@@ -337,6 +310,9 @@ namespace arti::curl {
 
         curl_easy_setopt(curl_handle, CURLOPT_USERAGENT, connection_info.custom_user_agent.c_str());
 
+        // HTTP/2 where TLS negotiates it, plain HTTP stays on 1.1
+        curl_easy_setopt(curl_handle, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2TLS);
+
         if (connection_info.timeout) {
             curl_easy_setopt(curl_handle, CURLOPT_TIMEOUT, connection_info.timeout);
             curl_easy_setopt(curl_handle, CURLOPT_NOSIGNAL, 1);
@@ -408,6 +384,11 @@ namespace arti::curl {
 
             std::string error_str = curl_easy_strerror(res);
 
+            curl_slist_free_all(header_list);
+            curl_easy_reset(curl_handle);
+
+            body_pool::global().recycle(std::move(resp.body));
+
             return error<response_error>{{
                 .code = res,
                 .message = std::move(error_str)
@@ -0,0 +1,213 @@
+#include <arti/curl/connection_pool.hpp>
+
+#include <arti/curl/share.hpp>
+
+#include <utility>
+#include <algorithm>
+
+#include <fmt/format.h>
+
+namespace arti::curl {
+
+    connection_pool::lease::lease(connection_pool *owner, std::string key, CURL *handle) noexcept
+        : pool(owner)
+        , host_key(std::move(key))
+        , curl_handle(handle) { }
+
+    connection_pool::lease::~lease() {
+        release();
+    }
+
+    connection_pool::lease::lease(lease &&other) noexcept
+        : pool(std::exchange(other.pool, nullptr))
+        , host_key(std::move(other.host_key))
+        , curl_handle(std::exchange(other.curl_handle, nullptr)) { }
+
+    connection_pool::lease &connection_pool::lease::operator=(lease &&other) noexcept {
+        if (this != &other) {
+            release();
+
+            pool = std::exchange(other.pool, nullptr);
+            host_key = std::move(other.host_key);
+            curl_handle = std::exchange(other.curl_handle, nullptr);
+        }
+
+        return *this;
+    }
+
+    CURL *connection_pool::lease::get() const noexcept {
+        return curl_handle;
+    }
+
+    connection_pool::lease::operator bool() const noexcept {
+        return curl_handle != nullptr;
+    }
+
+    void connection_pool::lease::release() noexcept {
+        if (pool and curl_handle) {
+            pool->release(host_key, curl_handle);
+        }
+
+        pool = nullptr;
+        curl_handle = nullptr;
+    }
+
+    connection_pool::connection_pool(pool_options opts)
+        : options(opts)
+        , reused(0)
+        , created(0)
+        , evicted(0)
+        , waited(0) {
+        options.max_per_host = std::max<std::size_t>(options.max_per_host, 1);
+
+        // Constructed first so it's destroyed after the handles attached to it
+        (void) share::global();
+    }
+
+    connection_pool::~connection_pool() {
+        for (auto &[key, entry] : hosts) {
+            for (auto &idle : entry.idle) {
+                curl_easy_cleanup(idle.handle);
+            }
+        }
+    }
+
+    connection_pool &connection_pool::global() {
+        static connection_pool pool;
+        return pool;
+    }
+
+    expected<connection_pool::lease> connection_pool::acquire(std::string_view url) {
+        auto key = key_for(url);
+        auto now = std::chrono::steady_clock::now();
+
+        std::vector<CURL *> expired;
+        CURL *handle = nullptr;
+
+        {
+            std::unique_lock lock(mtx);
+
+            collect_expired(now, expired);
+
+            auto &entry = hosts[key];
+
+            if (entry.idle.empty() and entry.in_use >= options.max_per_host) {
+                ++waited;
+
+                released.wait(lock, [&] {
+                    return not entry.idle.empty() or entry.in_use < options.max_per_host;
+                });
+            }
+
+            // Most recently used first, it's the least likely to have been
+            // closed by the server
+            if (not entry.idle.empty()) {
+                handle = entry.idle.back().handle;
+                entry.idle.pop_back();
+                ++reused;
+            }
+
+            ++entry.in_use;
+        }
+
+        for (auto *old : expired) {
+            curl_easy_cleanup(old);
+        }
+
+        if (handle == nullptr) {
+            handle = curl_easy_init();
+
+            if (handle == nullptr) {
+                std::scoped_lock lock(mtx);
+                --hosts[key].in_use;
+                released.notify_one();
+
+                return error<>{ "Couldn't initialize curl handle" };
+            }
+
+            std::scoped_lock lock(mtx);
+            ++created;
+        }
+
+        return lease{ this, std::move(key), handle };
+    }
+
+    connection_pool::statistics connection_pool::stats() const {
+        std::scoped_lock lock(mtx);
+
+        statistics result{
+            .reused = reused,
+            .created = created,
+            .evicted = evicted,
+            .waited = waited,
+            .idle = 0,
+            .in_use = 0
+        };
+
+        for (const auto &[key, entry] : hosts) {
+            result.idle += entry.idle.size();
+            result.in_use += entry.in_use;
+        }
+
+        return result;
+    }
+
+    std::string connection_pool::key_for(std::string_view url) {
+        std::string_view scheme = "http";
+
+        if (auto separator = url.find("://"); separator != std::string_view::npos) {
+            scheme = url.substr(0, separator);
+            url.remove_prefix(separator + 3);
+        }
+
+        auto authority = url.substr(0, url.find_first_of("/?#"));
+
+        if (auto at = authority.rfind('@'); at != std::string_view::npos) {
+            authority.remove_prefix(at + 1);
+        }
+
+        // A colon after the closing bracket of an IPv6 literal, or any colon
+        // otherwise, starts the port
+        auto closing = authority.rfind(']');
+        auto colon = authority.rfind(':');
+
+        if (colon != std::string_view::npos and (closing == std::string_view::npos or colon > closing)) {
+            return fmt::format("{}://{}", scheme, authority);
+        }
+
+        return fmt::format("{}://{}:{}", scheme, authority, scheme == "https" ? 443 : 80);
+    }
+
+    void connection_pool::release(const std::string &key, CURL *handle) noexcept {
+        // Drops every option of the finished request, the cached connection,
+        // DNS entries and TLS session stay
+        curl_easy_reset(handle);
+
+        {
+            std::scoped_lock lock(mtx);
+
+            auto &entry = hosts[key];
+            --entry.in_use;
+            entry.idle.push_back({ handle, std::chrono::steady_clock::now() });
+        }
+
+        released.notify_all();
+    }
+
+    void connection_pool::collect_expired(std::chrono::steady_clock::time_point now, std::vector<CURL *> &expired) {
+        for (auto &[key, entry] : hosts) {
+            // idle is ordered by release time, the expired ones are at the front
+            auto first_alive = std::find_if(entry.idle.begin(), entry.idle.end(), [&](const idle_handle &idle) {
+                return now - idle.since < options.idle_timeout;
+            });
+
+            for (auto it = entry.idle.begin(); it != first_alive; ++it) {
+                expired.push_back(it->handle);
+            }
+
+            evicted += static_cast<uint64_t>(std::distance(entry.idle.begin(), first_alive));
+            entry.idle.erase(entry.idle.begin(), first_alive);
+        }
+    }
+
+}    // namespace arti::curl
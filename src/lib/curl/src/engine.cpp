@@ -0,0 +1,344 @@
+#include <arti/curl/engine.hpp>
+
+#include <array>
+#include <utility>
+#include <exception>
+
+#include <arti/curl/info.hpp>
+#include <arti/curl/share.hpp>
+#include <arti/curl/body_pool.hpp>
+
+#include "transfer_callbacks.hpp"
+
+#include <fmt/format.h>
+#include <spdlog/spdlog.h>
+
+namespace arti::curl {
+
+    struct engine::transfer {
+        http_request request;
+        completion_callback on_done;
+
+        response resp;
+        curl_slist *header_list = nullptr;
+        std::array<char, CURL_ERROR_SIZE> error_buffer{};
+
+        ~transfer() {
+            curl_slist_free_all(header_list);
+        }
+    };
+
+    engine::engine(engine_options opts)
+        : options(opts)
+        , multi(curl_multi_init())
+        , completed(0)
+        , failed(0)
+        , http2_responses(0)
+        , http1_responses(0)
+        , connections(0)
+        , in_flight(0)
+        , peak_in_flight(0)
+        , stopping(false) {
+        // Constructed first so it's destroyed after the handles attached to it
+        (void) share::global();
+
+        curl_multi_setopt(multi, CURLMOPT_MAX_HOST_CONNECTIONS, options.max_host_connections);
+        curl_multi_setopt(multi, CURLMOPT_MAXCONNECTS, options.max_total_connections);
+
+        // Concurrent requests to one host share a connection as HTTP/2 streams
+        curl_multi_setopt(multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+        curl_multi_setopt(multi, CURLMOPT_MAX_CONCURRENT_STREAMS, options.max_concurrent_streams);
+
+        if (not (curl_version_info(CURLVERSION_NOW)->features & CURL_VERSION_HTTP2)) {
+            spdlog::warn("libcurl was built without HTTP/2, requests won't be multiplexed");
+        }
+
+        event_thread = std::thread([this] {
+            run();
+        });
+    }
+
+    engine::~engine() {
+        stop();
+
+        for (auto *handle : spare_handles) {
+            curl_easy_cleanup(handle);
+        }
+
+        curl_multi_cleanup(multi);
+    }
+
+    engine &engine::global() {
+        static engine instance;
+        return instance;
+    }
+
+    void engine::stop() {
+        {
+            std::scoped_lock lock(submit_mtx);
+            stopping = true;
+        }
+
+        curl_multi_wakeup(multi);
+
+        if (event_thread.joinable()) {
+            event_thread.join();
+        }
+    }
+
+    void engine::submit(http_request request, completion_callback on_done) {
+        auto pending = std::make_unique<transfer>();
+        pending->request = std::move(request);
+        pending->on_done = std::move(on_done);
+
+        {
+            std::scoped_lock lock(submit_mtx);
+
+            if (not stopping) {
+                submitted.push_back(std::move(pending));
+                pending = nullptr;
+            }
+        }
+
+        if (pending) {
+            complete(pending->on_done, error<response_error>{{ .code = -1, .message = "HTTP engine stopped" }});
+            return;
+        }
+
+        curl_multi_wakeup(multi);
+    }
+
+    std::future<request_result> engine::submit(http_request request) {
+        auto done = std::make_shared<std::promise<request_result>>();
+        auto result = done->get_future();
+
+        submit(std::move(request), [done](request_result finished) {
+            done->set_value(std::move(finished));
+        });
+
+        return result;
+    }
+
+    engine::request_operation engine::send(http_request request) {
+        return { this, std::move(request) };
+    }
+
+    engine::statistics engine::stats() const {
+        return {
+            .completed = completed.load(std::memory_order_relaxed),
+            .failed = failed.load(std::memory_order_relaxed),
+            .http2_responses = http2_responses.load(std::memory_order_relaxed),
+            .http1_responses = http1_responses.load(std::memory_order_relaxed),
+            .connections = connections.load(std::memory_order_relaxed),
+            .in_flight = in_flight.load(std::memory_order_relaxed),
+            .peak_in_flight = peak_in_flight.load(std::memory_order_relaxed)
+        };
+    }
+
+    void engine::run() {
+        std::vector<std::unique_ptr<transfer>> incoming;
+
+        while (not stopping) {
+            {
+                std::scoped_lock lock(submit_mtx);
+                incoming.swap(submitted);
+            }
+
+            auto progressed = not incoming.empty();
+
+            for (auto &pending : incoming) {
+                start(std::move(pending));
+            }
+
+            incoming.clear();
+
+            int still_running = 0;
+            curl_multi_perform(multi, &still_running);
+
+            int queued = 0;
+
+            while (auto *msg = curl_multi_info_read(multi, &queued)) {
+                if (msg->msg == CURLMSG_DONE) {
+                    finish(msg->easy_handle, msg->data.result);
+                    progressed = true;
+                }
+            }
+
+            // Removing a finished transfer can hand its connection to one that
+            // was waiting for it, which curl_multi_poll doesn't always notice.
+            // Perform again before sleeping
+            if (progressed) {
+                continue;
+            }
+
+            // Sleeps until a socket is ready, a timeout is due or something is
+            // submitted, curl_multi_wakeup cuts it short
+            curl_multi_poll(multi, nullptr, 0, 1000, nullptr);
+        }
+
+        // Nobody is left to wait for the rest
+        {
+            std::scoped_lock lock(submit_mtx);
+            incoming.swap(submitted);
+        }
+
+        for (auto &pending : incoming) {
+            complete(pending->on_done, error<response_error>{{ .code = -1, .message = "HTTP engine stopped" }});
+        }
+
+        for (auto &[handle, running] : active) {
+            curl_multi_remove_handle(multi, handle);
+            complete(running->on_done, error<response_error>{{ .code = -1, .message = "HTTP engine stopped" }});
+            curl_easy_cleanup(handle);
+        }
+
+        active.clear();
+    }
+
+    void engine::start(std::unique_ptr<transfer> pending) {
+        auto *handle = take_handle();
+
+        if (handle == nullptr) {
+            complete(pending->on_done, error<response_error>{{ .code = -1, .message = "Couldn't initialize curl handle" }});
+            return;
+        }
+
+        auto &request = pending->request;
+
+        curl_easy_setopt(handle, CURLOPT_URL, request.url.c_str());
+        curl_easy_setopt(handle, CURLOPT_PRIVATE, pending.get());
+
+        share::global().attach(handle);
+
+        curl_easy_setopt(handle, CURLOPT_WRITEFUNCTION, detail::write_body);
+        curl_easy_setopt(handle, CURLOPT_WRITEDATA, &pending->resp);
+        curl_easy_setopt(handle, CURLOPT_HEADERFUNCTION, detail::write_header);
+        curl_easy_setopt(handle, CURLOPT_HEADERDATA, &pending->resp);
+        curl_easy_setopt(handle, CURLOPT_ERRORBUFFER, pending->error_buffer.data());
+        curl_easy_setopt(handle, CURLOPT_NOSIGNAL, 1L);
+
+        // HTTP/2 where TLS negotiates it. PIPEWAIT makes a request wait for a
+        // connection still being set up to the same host, to multiplex on it,
+        // instead of opening one of its own
+        curl_easy_setopt(handle, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2TLS);
+        curl_easy_setopt(handle, CURLOPT_PIPEWAIT, 1L);
+
+        static const auto user_agent = fmt::format("arti-curl/{}", curl::info::version);
+        curl_easy_setopt(handle, CURLOPT_USERAGENT, user_agent.c_str());
+
+        for (const auto &[k, v] : request.headers) {
+            pending->header_list = curl_slist_append(pending->header_list, fmt::format("{}: {}", k, v).c_str());
+        }
+
+        curl_easy_setopt(handle, CURLOPT_HTTPHEADER, pending->header_list);
+
+        if (request.method == "HEAD") {
+            curl_easy_setopt(handle, CURLOPT_NOBODY, 1L);
+        }
+        else if (request.method != "GET") {
+            // POSTFIELDS with an explicit size also sends Content-Length: 0 for
+            // an empty body, which the API wants on PUT
+            curl_easy_setopt(handle, CURLOPT_POSTFIELDSIZE, static_cast<long>(request.body.size()));
+            curl_easy_setopt(handle, CURLOPT_POSTFIELDS, request.body.c_str());
+
+            if (request.method != "POST") {
+                curl_easy_setopt(handle, CURLOPT_CUSTOMREQUEST, request.method.c_str());
+            }
+        }
+
+        if (request.timeout > 0) {
+            curl_easy_setopt(handle, CURLOPT_TIMEOUT, static_cast<long>(request.timeout));
+        }
+
+        if (auto added = curl_multi_add_handle(multi, handle); added != CURLM_OK) {
+            curl_easy_cleanup(handle);
+            complete(pending->on_done, error<response_error>{{ .code = -1, .message = curl_multi_strerror(added) }});
+            return;
+        }
+
+        active.emplace(handle, std::move(pending));
+
+        auto now_in_flight = in_flight.fetch_add(1, std::memory_order_relaxed) + 1;
+
+        if (now_in_flight > peak_in_flight.load(std::memory_order_relaxed)) {
+            peak_in_flight.store(now_in_flight, std::memory_order_relaxed);
+        }
+    }
+
+    void engine::finish(CURL *handle, CURLcode code) {
+        curl_multi_remove_handle(multi, handle);
+
+        auto node = active.extract(handle);
+
+        if (node.empty()) {
+            spdlog::error("HTTP engine finished a transfer it doesn't know about");
+            return;
+        }
+
+        auto done = std::move(node.mapped());
+
+        in_flight.fetch_sub(1, std::memory_order_relaxed);
+
+        long new_connections = 0;
+        curl_easy_getinfo(handle, CURLINFO_NUM_CONNECTS, &new_connections);
+        connections.fetch_add(static_cast<uint64_t>(new_connections), std::memory_order_relaxed);
+
+        request_result result = [&]() -> request_result {
+            if (code != CURLE_OK) {
+                failed.fetch_add(1, std::memory_order_relaxed);
+                body_pool::global().recycle(std::move(done->resp.body));
+
+                return error<response_error>{{ .code = code, .message = curl_easy_strerror(code) }};
+            }
+
+            completed.fetch_add(1, std::memory_order_relaxed);
+
+            long version = 0;
+            curl_easy_getinfo(handle, CURLINFO_HTTP_VERSION, &version);
+
+            if (version >= CURL_HTTP_VERSION_2_0) {
+                http2_responses.fetch_add(1, std::memory_order_relaxed);
+            }
+            else {
+                http1_responses.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            long http_code = 0;
+            curl_easy_getinfo(handle, CURLINFO_RESPONSE_CODE, &http_code);
+            done->resp.code = static_cast<int>(http_code);
+
+            return std::move(done->resp);
+        }();
+
+        // The connection stays in the multi handle's cache, the easy handle
+        // is only reset for the next transfer
+        curl_easy_reset(handle);
+        spare_handles.push_back(handle);
+
+        complete(done->on_done, std::move(result));
+    }
+
+    void engine::complete(completion_callback &on_done, request_result result) {
+        try {
+            on_done(std::move(result));
+        }
+        catch (std::exception &exc) {
+            spdlog::error(fmt::format("Unhandled exception in HTTP completion: '{}'", exc.what()));
+        }
+        catch (...) {
+            spdlog::error("Unhandled exception in HTTP completion");
+        }
+    }
+
+    CURL *engine::take_handle() {
+        if (spare_handles.empty()) {
+            return curl_easy_init();
+        }
+
+        auto *handle = spare_handles.back();
+        spare_handles.pop_back();
+
+        return handle;
+    }
+
+}    // namespace arti::curl
@@ -0,0 +1,104 @@
+#include <arti/curl/share.hpp>
+
+#ifdef ARTI_CURL_OPENSSL
+#include <openssl/ssl.h>
+#endif
+
+#include <spdlog/spdlog.h>
+
+namespace arti::curl {
+
+    share::share()
+        : share_handle(curl_share_init())
+        , resumed(0)
+        , full(0)
+        , unknown(0)
+        , plain(0) {
+        curl_share_setopt(share_handle, CURLSHOPT_LOCKFUNC, &share::lock);
+        curl_share_setopt(share_handle, CURLSHOPT_UNLOCKFUNC, &share::unlock);
+        curl_share_setopt(share_handle, CURLSHOPT_USERDATA, this);
+
+        // Not CURL_LOCK_DATA_CONNECT, libcurl's shared connection cache isn't
+        // safe with handles used from several threads at once. Connections are
+        // reused by the connection pool and the engine's multi handle instead
+        curl_share_setopt(share_handle, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+        curl_share_setopt(share_handle, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+    }
+
+    share::~share() {
+        // Fails while a handle is still attached, the process is exiting then
+        // and leaking it is harmless
+        if (curl_share_cleanup(share_handle) != CURLSHE_OK) {
+            spdlog::debug("curl share handle still in use at exit");
+        }
+    }
+
+    share &share::global() {
+        static share instance;
+        return instance;
+    }
+
+    void share::attach(CURL *handle) {
+        curl_easy_setopt(handle, CURLOPT_SHARE, share_handle);
+
+        curl_easy_setopt(handle, CURLOPT_PREREQFUNCTION, &share::on_connected);
+        curl_easy_setopt(handle, CURLOPT_PREREQDATA, handle);
+    }
+
+    share::statistics share::stats() const {
+        return {
+            .resumed_handshakes = resumed.load(std::memory_order_relaxed),
+            .full_handshakes = full.load(std::memory_order_relaxed),
+            .unknown_handshakes = unknown.load(std::memory_order_relaxed),
+            .plain_connections = plain.load(std::memory_order_relaxed)
+        };
+    }
+
+    void share::lock(CURL *, curl_lock_data data, curl_lock_access, void *user_data) {
+        static_cast<share *>(user_data)->locks[data].lock();
+    }
+
+    void share::unlock(CURL *, curl_lock_data data, void *user_data) {
+        static_cast<share *>(user_data)->locks[data].unlock();
+    }
+
+    // Runs once the connection is up and before the request is sent, the only
+    // point where its TLS state is still reachable from the handle
+    int share::on_connected(void *user_data, char *, char *, int, int) {
+        auto *handle = static_cast<CURL *>(user_data);
+        auto &self = global();
+
+        long new_connections = 0;
+        curl_easy_getinfo(handle, CURLINFO_NUM_CONNECTS, &new_connections);
+
+        // Reused connection, no handshake to count
+        if (new_connections == 0) {
+            return CURL_PREREQFUNC_OK;
+        }
+
+        curl_tlssessioninfo *tls = nullptr;
+        curl_easy_getinfo(handle, CURLINFO_TLS_SSL_PTR, &tls);
+
+        if (tls == nullptr or tls->backend == CURLSSLBACKEND_NONE or tls->internals == nullptr) {
+            self.plain.fetch_add(1, std::memory_order_relaxed);
+            return CURL_PREREQFUNC_OK;
+        }
+
+#ifdef ARTI_CURL_OPENSSL
+        if (tls->backend == CURLSSLBACKEND_OPENSSL) {
+            if (SSL_session_reused(static_cast<SSL *>(tls->internals))) {
+                self.resumed.fetch_add(1, std::memory_order_relaxed);
+            }
+            else {
+                self.full.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            return CURL_PREREQFUNC_OK;
+        }
+#endif
+
+        self.unknown.fetch_add(1, std::memory_order_relaxed);
+        return CURL_PREREQFUNC_OK;
+    }
+
+}    // namespace arti::curl
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <string>
+#include <cctype>
+#include <utility>
+#include <charconv>
+#include <algorithm>
+
+#include <arti/curl/client.hpp>
+#include <arti/curl/body_pool.hpp>
+
+// libcurl callbacks shared by the blocking connection and the multi engine,
+// user_data is the response being filled in
+namespace arti::curl::detail {
+
+    inline void trim(std::string &s) {
+        s.erase(std::find_if(s.rbegin(), s.rend(), [](unsigned char ch) {
+            return !std::isspace(ch);
+        }).base(), s.end());
+
+        s.erase(s.begin(), std::find_if(s.begin(), s.end(), [](unsigned char ch) {
+            return !std::isspace(ch);
+        }));
+    }
+
+    // Content-Length above this isn't trusted to pre-size the body, it grows
+    // as it arrives instead
+    inline constexpr size_t max_reserved_body = body_pool::size_classes.back();
+
+    // Zero when missing, malformed or too large to pre-size for. HTTP/2 sends
+    // header names in lower case
+    inline size_t content_length(const response &resp) {
+        auto header = resp.headers.find("Content-Length");
+
+        if (header == resp.headers.end()) {
+            header = resp.headers.find("content-length");
+        }
+
+        if (header == resp.headers.end()) {
+            return 0;
+        }
+
+        size_t length = 0;
+        const auto &value = header->second;
+
+        if (auto [end, ec] = std::from_chars(value.data(), value.data() + value.size(), length); ec != std::errc{} or length > max_reserved_body) {
+            return 0;
+        }
+
+        return length;
+    }
+
+    // Moves the body into a pooled buffer with room for at least capacity
+    // bytes, the old one goes back to the pool
+    inline void reserve_body(response &resp, size_t capacity) {
+        if (resp.body.capacity() >= capacity) {
+            return;
+        }
+
+        auto &pool = body_pool::global();
+        auto buffer = pool.acquire(capacity, &resp.body_allocations);
+
+        buffer.append(resp.body);
+        pool.recycle(std::exchange(resp.body, std::move(buffer)));
+    }
+
+    inline size_t write_body(void *data, size_t size, size_t nmemb, void *user_data) {
+        auto *resp = reinterpret_cast<response *>(user_data);
+        auto needed = resp->body.size() + size * nmemb;
+
+        // The whole body at once on the first chunk when its length is known,
+        // doubling through the pool otherwise
+        if (needed > resp->body.capacity()) {
+            auto capacity = std::max(needed, resp->body.capacity() * 2);
+
+            if (resp->body.empty()) {
+                capacity = std::max(capacity, content_length(*resp));
+            }
+
+            reserve_body(*resp, capacity);
+        }
+
+        resp->body.append(reinterpret_cast<char *>(data), size * nmemb);
+        return (size * nmemb);
+    }
+
+    inline size_t write_header(char *data, size_t size, size_t nmemb, void *user_data) {
+        auto *resp = reinterpret_cast<response *>(user_data);
+
+        std::string header{ data, size * nmemb };
+
+        size_t separator = header.find_first_of(':');
+
+        if (separator == std::string::npos) {
+            trim(header);
+
+            if (header.empty()) {
+                return (size * nmemb);
+            }
+
+            resp->headers[header] = "present";
+        }
+        else {
+            std::string key = header.substr(0, separator);
+            std::string value = header.substr(separator + 1);
+
+            trim(key);
+            trim(value);
+
+            resp->headers[key] = std::move(value);
+        }
+
+        return (size * nmemb);
+    }
+
+}    // namespace arti::curl::detail
@@ -2,6 +2,9 @@
 
 #include <nlohmann/json.hpp>
 
+#include <cppcoro/task.hpp>
+
+#include <arti/curl/engine.hpp>
 #include <arti/curl/connection.hpp>
 
 #include <arti/spotify/config.hpp>
@@ -30,9 +33,19 @@ namespace arti::spotify {
         expected<api_response> put(std::string_view endpoint, const nlohmann::json &data);
         expected<api_response> post(std::string_view endpoint, const nlohmann::json &data);
 
+        // The same calls on curl::engine, no thread waits while they're in
+        // flight. They resume on the engine's event thread
+        cppcoro::task<expected<api_response>> async_get(std::string endpoint);
+        cppcoro::task<expected<api_response>> async_del(std::string endpoint);
+
+        cppcoro::task<expected<api_response>> async_put(std::string endpoint, nlohmann::json data);
+        cppcoro::task<expected<api_response>> async_post(std::string endpoint, nlohmann::json data);
+
         const nlohmann::json &get_token_data() const;
 
       private:
+        cppcoro::task<expected<api_response>> send_async(std::string method, std::string endpoint, std::string body);
+
         std::filesystem::path store_path;
         static auth_token token;
     };
@@ -1,9 +1,14 @@
 #pragma once
 
 #include <mutex>
+#include <string>
 
 #include <nlohmann/json.hpp>
 
+#include <cppcoro/task.hpp>
+
+#include <arti/curl/client.hpp>
+
 #include <arti/spotify/config.hpp>
 
 namespace arti::spotify {
@@ -31,9 +36,19 @@ namespace arti::spotify {
 
         expected<std::string_view, token_error> get();
 
+        // Same as get(), but an expired token is renewed on curl::engine. It
+        // doesn't block, so it's safe on the engine's event thread
+        cppcoro::task<expected<std::string, token_error>> async_get();
+
         const nlohmann::json &get_data() const;
 
       private:
+        // The access token while it's valid, token_error::renew once expired
+        expected<std::string_view, token_error> current();
+
+        std::string renew_form();
+        expected<> store_renewed(expected<curl::response, curl::response_error> expected_response);
+
         std::mutex data_mtx;
         nlohmann::json data;
     };
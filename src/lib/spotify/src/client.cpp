@@ -3,6 +3,8 @@
 #include <fstream>
 #include <ranges>
 
+#include <arti/curl/body_pool.hpp>
+
 #include <fmt/format.h>
 #include <fmt/std.h>
 #include <spdlog/spdlog.h>
@@ -112,9 +114,12 @@ namespace arti::spotify {
             return nlohmann::json::parse(expected_response->body);
         }();
 
+        // Parsed in place, the buffer goes back for the next response
+        curl::body_pool::global().recycle(std::move(expected_response->body));
+
         return api_response{
             expected_response->code,
-            response_body 
+            std::move(response_body)
         };
 	}
 
@@ -157,9 +162,11 @@ namespace arti::spotify {
             return nlohmann::json::parse(expected_response->body);
         }();
 
+        curl::body_pool::global().recycle(std::move(expected_response->body));
+
         return api_response{
             expected_response->code,
-            response_body 
+            std::move(response_body)
         };
 	}
 
@@ -204,9 +211,11 @@ namespace arti::spotify {
             return nlohmann::json::parse(expected_response->body);
         }();
 
+        curl::body_pool::global().recycle(std::move(expected_response->body));
+
         return api_response{
             expected_response->code,
-            response_body 
+            std::move(response_body)
         };
 	}
 
@@ -249,10 +258,83 @@ namespace arti::spotify {
             return nlohmann::json::parse(expected_response->body);
         }();
 
+        curl::body_pool::global().recycle(std::move(expected_response->body));
+
         return api_response{
             expected_response->code,
-            response_body 
+            std::move(response_body)
         };
 	}
 
+    cppcoro::task<expected<api_response>> client::async_get(std::string endpoint) {
+        co_return co_await send_async("GET", std::move(endpoint), "");
+    }
+
+    cppcoro::task<expected<api_response>> client::async_del(std::string endpoint) {
+        co_return co_await send_async("DELETE", std::move(endpoint), "");
+    }
+
+    cppcoro::task<expected<api_response>> client::async_put(std::string endpoint, nlohmann::json data) {
+        co_return co_await send_async("PUT", std::move(endpoint), data.dump());
+    }
+
+    cppcoro::task<expected<api_response>> client::async_post(std::string endpoint, nlohmann::json data) {
+        co_return co_await send_async("POST", std::move(endpoint), data.dump());
+    }
+
+    cppcoro::task<expected<api_response>> client::send_async(std::string method, std::string endpoint, std::string body) {
+        // A renewal goes through the engine too, this may be running on its
+        // event thread and a blocking one would stall every transfer
+        auto expected_token = co_await token.async_get();
+
+        if (not expected_token) {
+            co_return error<>{ "Error getting the api token" };
+        }
+
+        curl::http_request request{
+            .method = std::move(method),
+            .url = fmt::format("https://api.spotify.com/v1{}", endpoint),
+            .headers = {
+                {
+                    "Authorization",
+                    fmt::format("Bearer {}", expected_token.value())
+                },
+                {
+                    "Content-Type",
+                    "application/json"
+                }
+            },
+            .body = std::move(body)
+        };
+
+        // Bound to a local first, GCC 12 mishandles aggregate temporaries
+        // inside a co_await expression
+        auto expected_response = co_await curl::engine::global().send(std::move(request));
+
+        if (not expected_response) {
+            co_return error<>{
+                fmt::format(
+                    "Curl error:\nCode {}, Response {}",
+                    expected_response.error().code,
+                    expected_response.error().message
+                )
+            };
+        }
+
+        auto response_body = [&] {
+            if (expected_response->body.empty()) {
+                return nlohmann::json{};
+            }
+
+            return nlohmann::json::parse(expected_response->body);
+        }();
+
+        curl::body_pool::global().recycle(std::move(expected_response->body));
+
+        co_return api_response{
+            expected_response->code,
+            std::move(response_body)
+        };
+    }
+
 }
@@ -9,7 +9,9 @@
 #include <fmt/format.h>
 #include <spdlog/spdlog.h>
 
+#include <arti/curl/engine.hpp>
 #include <arti/curl/client.hpp>
+#include <arti/curl/body_pool.hpp>
 
 #include <arti/spotify/utils.hpp>
 
@@ -162,6 +164,7 @@ namespace arti::spotify {
         }
 
         auto json_response = nlohmann::json::parse(response.body);
+        curl::body_pool::global().recycle(std::move(response.body));
 
         auto time = std::chrono::system_clock::now();
 
@@ -176,28 +179,37 @@ namespace arti::spotify {
         return {};
 	}
 
-    expected<> auth_token::renew_token() {
-        auto request_data = fmt::format(
-            "grant_type=refresh_token&refresh_token={}",
-            data["refresh_token"].get<std::string_view>()
-        );
-
+    static std::string basic_authorization() {
         auto authorization_token = fmt::format("{}:{}", client_id, client_secret);
+        return fmt::format("Basic {}", utils::encode_base64(authorization_token));
+    }
 
+    expected<> auth_token::renew_token() {
         auto expected_response = curl::request::post(
             "https://accounts.spotify.com/api/token",
             "application/x-www-form-urlencoded",
-            request_data,
+            renew_form(),
             {
                 {
                     "Authorization",
-                    fmt::format("Basic {}", 
-                        utils::encode_base64(authorization_token)
-                    )
+                    basic_authorization()
                 }
             }
         );
 
+        return store_renewed(std::move(expected_response));
+	}
+
+    std::string auth_token::renew_form() {
+        std::scoped_lock lock(data_mtx);
+
+        return fmt::format(
+            "grant_type=refresh_token&refresh_token={}",
+            data["refresh_token"].get<std::string_view>()
+        );
+    }
+
+    expected<> auth_token::store_renewed(expected<curl::response, curl::response_error> expected_response) {
         if (not expected_response) {
             return error<>{
                 fmt::format(
@@ -221,6 +233,7 @@ namespace arti::spotify {
         }
 
         auto json_response = nlohmann::json::parse(response.body);
+        curl::body_pool::global().recycle(std::move(response.body));
 
         auto time = std::chrono::system_clock::now();
 
@@ -236,26 +249,32 @@ namespace arti::spotify {
         }
 
         return {};
-	}
+    }
 
-    expected<std::string_view, token_error> auth_token::get() {
-        {
-            std::scoped_lock lock(data_mtx);
+    expected<std::string_view, token_error> auth_token::current() {
+        std::scoped_lock lock(data_mtx);
 
-            if (not data.contains("access_token")) {
-                return error<token_error>{ token_error::no_data };
-            }
+        if (not data.contains("access_token")) {
+            return error<token_error>{ token_error::no_data };
+        }
 
-            auto now_timestamp = std::chrono::duration_cast<std::chrono::seconds>(
-                std::chrono::system_clock::now().time_since_epoch()
-            ).count();
+        auto now_timestamp = std::chrono::duration_cast<std::chrono::seconds>(
+            std::chrono::system_clock::now().time_since_epoch()
+        ).count();
 
-            auto request_timestamp = data["timestamp"].get<int64_t>();
-            auto expiracy_time = data["expires_in"].get<int64_t>();
+        auto request_timestamp = data["timestamp"].get<int64_t>();
+        auto expiracy_time = data["expires_in"].get<int64_t>();
 
-            if (((now_timestamp + 1) - request_timestamp) < expiracy_time) {
-                return data["access_token"].get<std::string_view>();
-            }
+        if (((now_timestamp + 1) - request_timestamp) < expiracy_time) {
+            return data["access_token"].get<std::string_view>();
+        }
+
+        return error<token_error>{ token_error::renew };
+    }
+
+    expected<std::string_view, token_error> auth_token::get() {
+        if (auto token = current(); token or token.error() == token_error::no_data) {
+            return token;
         }
 
         auto expected_response = renew_token();
@@ -268,6 +287,47 @@ namespace arti::spotify {
         return data["access_token"].get<std::string_view>();
 	}
 
+    cppcoro::task<expected<std::string, token_error>> auth_token::async_get() {
+        if (auto token = current(); token) {
+            co_return std::string{ *token };
+        }
+        else if (token.error() == token_error::no_data) {
+            co_return error<token_error>{ token_error::no_data };
+        }
+
+        curl::http_request request{
+            .method = "POST",
+            .url = "https://accounts.spotify.com/api/token",
+            .headers = {
+                {
+                    "Authorization",
+                    basic_authorization()
+                },
+                {
+                    "Content-Type",
+                    "application/x-www-form-urlencoded"
+                }
+            },
+            .body = renew_form()
+        };
+
+        auto expected_response = co_await curl::engine::global().send(std::move(request));
+
+        if (auto renewed = store_renewed(std::move(expected_response)); not renewed) {
+            spdlog::error(fmt::format("Couldn't renew the api token: {}", renewed.error()));
+            co_return error<token_error>{ token_error::renew };
+        }
+
+        std::string access_token;
+
+        {
+            std::scoped_lock lock(data_mtx);
+            access_token = data["access_token"].get<std::string>();
+        }
+
+        co_return access_token;
+    }
+
     void on_message_callback(mg_connection *conn, int ev, void *ev_data, void *fn_data) {
         if (ev == MG_EV_HTTP_MSG) {
             auto http_message = static_cast<mg_http_message *>(ev_data);